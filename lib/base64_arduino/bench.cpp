@@ -0,0 +1,225 @@
+// Benchmark harness for the base64 kernels. Build and run with `make bench`
+//
+// Measures every kernel the CPU supports, for each operation, across input sizes from 16 bytes (a signature
+// tag) to 1 MiB. Each measurement runs a number of timed batches and reports per-call latency (min, median,
+// max over the batches) and throughput from the median. Results are printed as a table and, with
+// --json FILE, written as JSON for tracking regressions between releases
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "base64.hpp"
+#include "z85.hpp"
+
+static const unsigned int max_size = 1 << 20;
+static unsigned char binary[max_size];
+static unsigned char base64[max_size/3*4 + 5];
+static unsigned char decoded[max_size];
+static unsigned char z85[max_size/4*5 + 1];
+
+// Keeps the compiler from discarding kernel results
+static volatile size_t sink;
+
+// Keeps the compiler from hoisting calls with unchanged inputs out of a loop
+static inline void clobber() {
+#if defined(__GNUC__)
+  asm volatile("" : : : "memory");
+#endif
+}
+
+// Timestamp counter on x86, 0 elsewhere
+static unsigned long long cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static double nanoseconds() {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One kernel call on the prepared buffers, for an input of `size` binary bytes
+typedef void (*bench_call)(unsigned int size);
+
+struct benchmark {
+  const char *operation;
+  const char *kernel;
+  int simd_level;          // Minimum base64_simd_level() needed
+  unsigned int only_size;  // Fixed-size kernels run at this size only, 0 for all sizes
+  bench_call call;
+};
+
+static const benchmark benchmarks[] = {
+  {"encode", "branchy", BASE64_SIMD_NONE, 0, [](unsigned int n) { sink = encode_base64_branchy(binary, n, base64); }},
+  {"encode", "table",   BASE64_SIMD_NONE, 0, [](unsigned int n) { sink = encode_base64_table(binary, n, base64); }},
+  {"encode", "swar",    BASE64_SIMD_NONE, 0, [](unsigned int n) { sink = encode_base64_swar(binary, n, base64); }},
+#ifdef BASE64_HAVE_X86_SIMD
+  {"encode", "sse41",   BASE64_SIMD_SSE41, 0, [](unsigned int n) { sink = encode_base64_sse41(binary, n, base64); }},
+  {"encode", "avx2",    BASE64_SIMD_AVX2, 0, [](unsigned int n) { sink = encode_base64_avx2(binary, n, base64); }},
+#endif
+  {"encode", "fixed",   BASE64_SIMD_NONE, 16, [](unsigned int) { encode_base64<16>(binary, base64); sink = base64[0]; }},
+  {"encode", "z85",     BASE64_SIMD_NONE, 0, [](unsigned int n) { sink = encode_z85(binary, n, z85); }},
+  {"encode", "z85_fixed", BASE64_SIMD_NONE, 16, [](unsigned int) { encode_z85<16>(binary, z85); sink = z85[0]; }},
+  
+  {"decode", "branchy", BASE64_SIMD_NONE, 0, [](unsigned int) { sink = decode_base64_branchy(base64, decoded); }},
+  {"decode", "table",   BASE64_SIMD_NONE, 0, [](unsigned int) { sink = decode_base64_table(base64, decoded); }},
+#ifdef BASE64_HAVE_X86_SIMD
+  {"decode", "sse41",   BASE64_SIMD_SSE41, 0, [](unsigned int) { sink = decode_base64_sse41(base64, decoded); }},
+  {"decode", "avx2",    BASE64_SIMD_AVX2, 0, [](unsigned int) { sink = decode_base64_avx2(base64, decoded); }},
+#endif
+  {"decode", "sized",   BASE64_SIMD_NONE, 0, [](unsigned int n) {
+    sink = decode_base64(base64, encode_base64_length(n), decoded, max_size);
+  }},
+  {"decode", "strict",  BASE64_SIMD_NONE, 0, [](unsigned int n) {
+    sink = decode_base64_strict(base64, encode_base64_length(n), decoded, max_size);
+  }},
+  {"decode", "fixed",   BASE64_SIMD_NONE, 16, [](unsigned int) { sink = decode_base64<16>(base64, decoded); }},
+  {"decode", "z85",     BASE64_SIMD_NONE, 0, [](unsigned int n) {
+    sink = decode_z85(z85, encode_z85_length(n), decoded, max_size);
+  }},
+  {"decode", "z85_fixed", BASE64_SIMD_NONE, 16, [](unsigned int) { sink = decode_z85<16>(z85, decoded); }},
+  
+  {"decode_length", "branchy", BASE64_SIMD_NONE, 0, [](unsigned int) { sink = decode_base64_length_branchy(base64); }},
+  {"decode_length", "table",   BASE64_SIMD_NONE, 0, [](unsigned int) { sink = decode_base64_length_table(base64); }},
+#ifdef BASE64_HAVE_X86_SIMD
+  {"decode_length", "sse41",   BASE64_SIMD_SSE41, 0, [](unsigned int) { sink = decode_base64_length_sse41(base64); }},
+  {"decode_length", "avx2",    BASE64_SIMD_AVX2, 0, [](unsigned int) { sink = decode_base64_length_avx2(base64); }},
+#endif
+};
+
+static const unsigned int sizes[] = {16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576};
+
+struct result {
+  const benchmark *bench;
+  unsigned int size;
+  double ns_min, ns_median, ns_max;  // Per call
+  double cycles_per_byte;            // 0 where there is no cycle counter
+  double mb_per_s;                   // Binary bytes per second, from the median
+};
+
+static result measure(const benchmark &bench, unsigned int size, unsigned int batches) {
+  // Each batch processes about 1 MiB
+  unsigned int calls = std::max(1u, (1u << 20)/size);
+  std::vector<double> ns(batches);
+  std::vector<double> cycle_counts(batches);
+  
+  bench.call(size); // Warm up caches and the branch predictor
+  
+  for(unsigned int b = 0; b < batches; ++b) {
+    double start = nanoseconds();
+    unsigned long long start_cycles = cycles();
+    for(unsigned int i = 0; i < calls; ++i) clobber(), bench.call(size);
+    cycle_counts[b] = (double) (cycles() - start_cycles)/calls;
+    ns[b] = (nanoseconds() - start)/calls;
+  }
+  
+  std::sort(ns.begin(), ns.end());
+  std::sort(cycle_counts.begin(), cycle_counts.end());
+  
+  result r;
+  r.bench = &bench;
+  r.size = size;
+  r.ns_min = ns.front();
+  r.ns_median = ns[batches/2];
+  r.ns_max = ns.back();
+  r.cycles_per_byte = cycle_counts[batches/2]/size;
+  r.mb_per_s = size/r.ns_median*1e3;
+  return r;
+}
+
+static bool write_json(const char *path, const std::vector<result> &results) {
+  FILE *file = fopen(path, "w");
+  if(!file) return false;
+  
+  fprintf(file, "{\n  \"library\": \"base64_arduino\",\n");
+#ifdef __VERSION__
+  fprintf(file, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+  fprintf(file, "  \"simd_level\": %d,\n  \"results\": [\n", base64_simd_level());
+  
+  for(size_t i = 0; i < results.size(); ++i) {
+    const result &r = results[i];
+    fprintf(file, "    {\"operation\": \"%s\", \"kernel\": \"%s\", \"bytes\": %u, "
+                  "\"ns_per_call_min\": %.1f, \"ns_per_call_median\": %.1f, \"ns_per_call_max\": %.1f, "
+                  "\"cycles_per_byte\": %.3f, \"mb_per_s\": %.1f}%s\n",
+            r.bench->operation, r.bench->kernel, r.size, r.ns_min, r.ns_median, r.ns_max,
+            r.cycles_per_byte, r.mb_per_s, i + 1 < results.size() ? "," : "");
+  }
+  
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: bench [--json FILE] [--quick] [--max-size BYTES]\n");
+}
+
+int main(int argc, char **argv) {
+  const char *json_path = 0;
+  unsigned int batches = 21;
+  unsigned int size_limit = max_size;
+  
+  for(int i = 1; i < argc; ++i) {
+    if(strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
+    else if(strcmp(argv[i], "--quick") == 0) batches = 5;
+    else if(strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) size_limit = strtoul(argv[++i], 0, 10);
+    else return usage(), 2;
+  }
+  
+  for(unsigned int i = 0; i < max_size; ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  std::vector<result> results;
+  
+  printf("%-14s %-10s %8s %12s %12s %12s %10s %10s\n",
+         "operation", "kernel", "bytes", "ns min", "ns median", "ns max", "cyc/byte", "MB/s");
+  
+  for(unsigned int s = 0; s < sizeof(sizes)/sizeof(sizes[0]) && sizes[s] <= size_limit; ++s) {
+    unsigned int size = sizes[s];
+    
+    // Decoders read the encoding of `size` bytes, followed by a null terminator
+    encode_base64_table(binary, size, base64);
+    encode_z85(binary, size, z85);
+    
+    for(unsigned int b = 0; b < sizeof(benchmarks)/sizeof(benchmarks[0]); ++b) {
+      const benchmark &bench = benchmarks[b];
+      if(bench.simd_level > base64_simd_level()) continue;
+      if(bench.only_size && bench.only_size != size) continue;
+      
+      result r = measure(bench, size, batches);
+      results.push_back(r);
+      
+      printf("%-14s %-10s %8u %12.1f %12.1f %12.1f %10.3f %10.1f\n", bench.operation, bench.kernel, size,
+             r.ns_min, r.ns_median, r.ns_max, r.cycles_per_byte, r.mb_per_s);
+      
+      // Every decoder must reproduce the input
+      if(strcmp(bench.operation, "decode") == 0 && memcmp(decoded, binary, size) != 0) {
+        fprintf(stderr, "%s/%s: round trip mismatch at %u bytes\n", bench.operation, bench.kernel, size);
+        return 1;
+      }
+    }
+    
+    // Encoders must have produced the reference encoding
+    unsigned char *reference = (unsigned char *) malloc(encode_base64_length(size) + 1);
+    encode_base64_branchy(binary, size, reference);
+    bool matches = memcmp(reference, base64, encode_base64_length(size)) == 0;
+    free(reference);
+    if(!matches) {
+      fprintf(stderr, "encode: output differs from encode_base64_branchy() at %u bytes\n", size);
+      return 1;
+    }
+  }
+  
+  if(json_path && !write_json(json_path, results)) {
+    fprintf(stderr, "could not write %s\n", json_path);
+    return 1;
+  }
+  
+  return 0;
+}
@@ -1,6 +1,7 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 #include "base64.hpp"
+#include "z85.hpp"
 
 TEST_CASE("encode_base64_length()", "[]") {
   SECTION("Zero length") {
@@ -462,4 +463,697 @@ TEST_CASE("decode_base64()", "[]") {
     decode_base64((unsigned char*) "AA==4n8fzhNL", actual_binary);
     REQUIRE(memcmp(actual_binary, expected_binary_6, 1) == 0);
   }
-}
\ No newline at end of file
+}
+TEST_CASE("Table kernels match branchy kernels", "[]") {
+  unsigned char binary[256];
+  unsigned char expected[400], actual[400];
+  
+  for(unsigned int i = 0; i < 256; ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  SECTION("encode_base64_table()") {
+    for(unsigned int length = 0; length <= 256; ++length) {
+      unsigned int expected_length = encode_base64_branchy(binary, length, expected);
+      REQUIRE(encode_base64_table(binary, length, actual) == expected_length);
+      REQUIRE(memcmp(actual, expected, expected_length + 1) == 0);
+    }
+  }
+  
+  SECTION("decode_base64_table()") {
+    unsigned char base64[400];
+    
+    // Every ascii code, valid or not, as the last character of strings of every remainder
+    for(unsigned int length = 0; length < 8; ++length) {
+      for(unsigned int c = 1; c < 256; ++c) {
+        memcpy(base64, "4n8fzhNL", length);
+        base64[length] = c;
+        base64[length + 1] = '\0';
+        
+        unsigned int expected_length = decode_base64_branchy(base64, expected);
+        REQUIRE(decode_base64_length_table(base64) == decode_base64_length_branchy(base64));
+        REQUIRE(decode_base64_table(base64, actual) == expected_length);
+        REQUIRE(memcmp(actual, expected, expected_length) == 0);
+      }
+    }
+  }
+}
+
+#ifdef BASE64_HAVE_X86_SIMD
+TEST_CASE("SIMD kernels match table kernels", "[]") {
+  unsigned char binary[300];
+  unsigned char base64[512], expected[512], actual[512];
+  
+  for(unsigned int i = 0; i < 300; ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  SECTION("encode_base64_sse41(), encode_base64_avx2()") {
+    for(unsigned int length = 0; length <= 300; ++length) {
+      unsigned int expected_length = encode_base64_table(binary, length, expected);
+      
+      if(base64_simd_level() >= BASE64_SIMD_SSE41) {
+        REQUIRE(encode_base64_sse41(binary, length, actual) == expected_length);
+        REQUIRE(memcmp(actual, expected, expected_length + 1) == 0);
+      }
+      
+      if(base64_simd_level() >= BASE64_SIMD_AVX2) {
+        REQUIRE(encode_base64_avx2(binary, length, actual) == expected_length);
+        REQUIRE(memcmp(actual, expected, expected_length + 1) == 0);
+      }
+    }
+  }
+  
+  SECTION("decode_base64_sse41(), decode_base64_avx2()") {
+    unsigned int base64_length = encode_base64_table(binary, 300, base64);
+    const unsigned char stops[] = {'\0', '=', '-', '_', ' ', 0x80, 0xFF};
+    
+    // A stop character at every position, with the string starting at every alignment
+    for(unsigned int offset = 0; offset < 32; ++offset) {
+      for(unsigned int stop = 0; stop < sizeof(stops); ++stop) {
+        for(unsigned int position = 0; position < 140; ++position) {
+          unsigned char *input = base64 + offset;
+          unsigned char saved = input[position];
+          input[position] = stops[stop];
+          
+          unsigned int expected_length = decode_base64_table(input, expected);
+          
+          if(base64_simd_level() >= BASE64_SIMD_SSE41) {
+            REQUIRE(decode_base64_length_sse41(input) == expected_length);
+            REQUIRE(decode_base64_sse41(input, actual) == expected_length);
+            REQUIRE(memcmp(actual, expected, expected_length) == 0);
+          }
+          
+          if(base64_simd_level() >= BASE64_SIMD_AVX2) {
+            REQUIRE(decode_base64_length_avx2(input) == expected_length);
+            REQUIRE(decode_base64_avx2(input, actual) == expected_length);
+            REQUIRE(memcmp(actual, expected, expected_length) == 0);
+          }
+          
+          input[position] = saved;
+        }
+      }
+    }
+    
+    REQUIRE(decode_base64(base64, actual) == 300);
+    REQUIRE(base64_length == 400);
+    REQUIRE(memcmp(actual, binary, 300) == 0);
+  }
+}
+#endif
+
+TEST_CASE("SWAR kernel matches branchy kernel", "[]") {
+  unsigned char binary[256];
+  unsigned char expected[400], actual[400];
+  
+  SECTION("Every length") {
+    for(unsigned int i = 0; i < 256; ++i) binary[i] = (unsigned char) (i*167 + 13);
+    
+    for(unsigned int length = 0; length <= 256; ++length) {
+      unsigned int expected_length = encode_base64_branchy(binary, length, expected);
+      REQUIRE(encode_base64_swar(binary, length, actual) == expected_length);
+      REQUIRE(memcmp(actual, expected, expected_length + 1) == 0);
+    }
+  }
+  
+  SECTION("Every 6-bit value in every position") {
+    for(unsigned int a = 0; a < 256; ++a) {
+      for(unsigned int b = 0; b < 256; ++b) {
+        unsigned char group[] = {(unsigned char) a, (unsigned char) b, (unsigned char) (a ^ b)};
+        encode_base64_branchy(group, 3, expected);
+        encode_base64_swar(group, 3, actual);
+        REQUIRE(memcmp(actual, expected, 5) == 0);
+      }
+    }
+  }
+}
+
+TEST_CASE("decode_base64() with explicit length", "[]") {
+  unsigned char expected[100], actual[100];
+  
+  SECTION("Length in O(1)") {
+    REQUIRE(decode_base64_length((const unsigned char*) "", 0) == 0);
+    REQUIRE(decode_base64_length((const unsigned char*) "Aw==", 4) == 1);
+    REQUIRE(decode_base64_length((const unsigned char*) "Aw", 2) == 1);
+    REQUIRE(decode_base64_length((const unsigned char*) "a/g=", 4) == 2);
+    REQUIRE(decode_base64_length((const unsigned char*) "4n8fzhNL", 8) == 6);
+    REQUIRE(decode_base64_length((const unsigned char*) "4n8fzhNLI1A=", 12) == 8);
+  }
+  
+  SECTION("Matches null-terminated decode_base64()") {
+    const char *inputs[] = {
+      "", "AA==", "Aw", "a/g=", "//8", "4n8fzhNL", "4n8fzhNLI1A=", "Y+Enwwgr0ZcIK8O3==",
+      "AA==4n8fzhNL", "Aw=4n8fzhNL", "a/g=4n8fzhNL==", "4n8fzhNLI1A=4n8fzhNL====",
+      "Aw========", "a/g==========", "4n8fzhNLI1A===========", "4n8f zhNL", "4n8fz", "4n8f-_NL"
+    };
+    
+    for(unsigned int i = 0; i < sizeof(inputs)/sizeof(inputs[0]); ++i) {
+      unsigned int length = strlen(inputs[i]);
+      unsigned int expected_length = decode_base64_branchy((unsigned char*) inputs[i], expected);
+      
+      REQUIRE(decode_base64((const unsigned char*) inputs[i], length, actual, sizeof(actual)) == expected_length);
+      REQUIRE(memcmp(actual, expected, expected_length) == 0);
+    }
+  }
+  
+  SECTION("Slice of a larger buffer") {
+    const char *payload = "liberar:1577836800$4n8fzhNLI1A=trailing";
+    unsigned char expected_binary[] = {226, 127, 31, 206, 19, 75, 35, 80};
+    
+    REQUIRE(decode_base64((const unsigned char*) payload + 19, 12, actual, 8) == 8);
+    REQUIRE(memcmp(actual, expected_binary, 8) == 0);
+  }
+  
+  SECTION("Output capacity too small") {
+    memset(actual, 0xAA, sizeof(actual));
+    REQUIRE(decode_base64((const unsigned char*) "4n8fzhNLI1A=", 12, actual, 7) == 0);
+    REQUIRE(actual[0] == 0xAA);
+  }
+}
+
+TEST_CASE("Streaming encoder and decoder", "[]") {
+  unsigned char binary[200];
+  unsigned char expected[300], actual[300];
+  
+  for(unsigned int i = 0; i < 200; ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  SECTION("Encoding in chunks matches encode_base64()") {
+    for(unsigned int length = 0; length <= 200; length += 7) {
+      unsigned int expected_length = encode_base64_branchy(binary, length, expected);
+      
+      for(unsigned int chunk = 1; chunk <= 17; ++chunk) {
+        base64_encoder encoder;
+        base64_encoder_init(&encoder);
+        
+        unsigned int written = 0;
+        for(unsigned int i = 0; i < length; i += chunk) {
+          unsigned int size = length - i < chunk ? length - i : chunk;
+          written += base64_encoder_update(&encoder, binary + i, size, actual + written);
+        }
+        written += base64_encoder_finish(&encoder, actual + written);
+        
+        REQUIRE(written == expected_length);
+        REQUIRE(memcmp(actual, expected, expected_length) == 0);
+      }
+    }
+  }
+  
+  SECTION("Updates that complete no group write an empty string") {
+    base64_encoder encoder;
+    base64_encoder_init(&encoder);
+    
+    memset(actual, 'x', sizeof(actual));
+    REQUIRE(base64_encoder_update(&encoder, binary, 1, actual) == 0);
+    REQUIRE(strcmp((char *) actual, "") == 0);
+    
+    // Left over from the previous call, still short of a group
+    memset(actual, 'x', sizeof(actual));
+    REQUIRE(base64_encoder_update(&encoder, binary + 1, 1, actual) == 0);
+    REQUIRE(strcmp((char *) actual, "") == 0);
+    
+    memset(actual, 'x', sizeof(actual));
+    REQUIRE(base64_encoder_update(&encoder, binary + 2, 1, actual) == 4);
+    REQUIRE(base64_encoder_finish(&encoder, actual + 4) == 0);
+    encode_base64_branchy(binary, 3, expected);
+    REQUIRE(strcmp((char *) actual, (char *) expected) == 0);
+  }
+  
+  SECTION("Decoding in chunks matches decode_base64()") {
+    const char *inputs[] = {
+      "", "AA==", "Aw", "a/g=", "//8", "4n8fzhNL", "4n8fzhNLI1A=", "Y+Enwwgr0ZcIK8O3==",
+      "AA==4n8fzhNL", "Aw=4n8fzhNL", "a/g=4n8fzhNL==", "4n8fzhNLI1A=4n8fzhNL====", "4n8fz",
+      "3FxDX51MotLgyoidaLJnUSNn9EdcGUVAPejGbNlqP2fqJ5xsBGXUxjnfS4SgGsGLEFkMLbeFIQ==4n8fzhNL"
+    };
+    
+    for(unsigned int i = 0; i < sizeof(inputs)/sizeof(inputs[0]); ++i) {
+      unsigned int length = strlen(inputs[i]);
+      unsigned int expected_length = decode_base64_branchy((unsigned char*) inputs[i], expected);
+      
+      for(unsigned int chunk = 1; chunk <= 9; ++chunk) {
+        base64_decoder decoder;
+        base64_decoder_init(&decoder);
+        
+        unsigned int written = 0;
+        for(unsigned int j = 0; j < length; j += chunk) {
+          unsigned int size = length - j < chunk ? length - j : chunk;
+          written += base64_decoder_update(&decoder, (const unsigned char*) inputs[i] + j, size, actual + written);
+        }
+        written += base64_decoder_finish(&decoder, actual + written);
+        
+        REQUIRE(written == expected_length);
+        REQUIRE(memcmp(actual, expected, expected_length) == 0);
+      }
+    }
+  }
+}
+
+#if __cplusplus >= 201703L
+template <typename Array>
+constexpr bool equals(const Array &actual, const char *expected) {
+  for(size_t i = 0; i < actual.size(); ++i) {
+    if(actual[i] != (unsigned char) expected[i]) return false;
+  }
+  return true;
+}
+
+constexpr unsigned char fixed_binary[] = {133, 244, 117, 206, 178, 195, 99, 225, 39, 195, 8, 43, 209, 151, 8, 43};
+static_assert(equals(encode_base64(fixed_binary), "hfR1zrLDY+Enwwgr0ZcIKw=="), "encode_base64() at compile time");
+static_assert(decode_base64<16>("hfR1zrLDY+Enwwgr0ZcIKw==")[15] == 43, "decode_base64<N>() at compile time");
+static_assert(decode_base64<6>("hfR1zrLD")[0] == 133, "decode_base64<N>() at compile time");
+
+TEST_CASE("Fixed-size encode_base64<N>() and decode_base64<N>()", "[]") {
+  unsigned char binary[20];
+  unsigned char expected[40], actual[40];
+  
+  for(unsigned int i = 0; i < 20; ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  SECTION("Every remainder matches encode_base64()") {
+    encode_base64_branchy(binary, 16, expected);
+    encode_base64<16>(binary, actual);
+    REQUIRE(memcmp(actual, expected, 24) == 0);
+    
+    encode_base64_branchy(binary, 17, expected);
+    encode_base64<17>(binary, actual);
+    REQUIRE(memcmp(actual, expected, 24) == 0);
+    
+    encode_base64_branchy(binary, 18, expected);
+    encode_base64<18>(binary, actual);
+    REQUIRE(memcmp(actual, expected, 24) == 0);
+  }
+  
+  SECTION("Every remainder matches decode_base64()") {
+    encode_base64_branchy(binary, 16, expected);
+    REQUIRE(decode_base64<16>(expected, actual) == 16);
+    REQUIRE(memcmp(actual, binary, 16) == 0);
+    
+    encode_base64_branchy(binary, 17, expected);
+    REQUIRE(decode_base64<17>(expected, actual) == 17);
+    REQUIRE(memcmp(actual, binary, 17) == 0);
+    
+    encode_base64_branchy(binary, 18, expected);
+    REQUIRE(decode_base64<18>(expected, actual) == 18);
+    REQUIRE(memcmp(actual, binary, 18) == 0);
+  }
+  
+  SECTION("Invalid characters end decoding") {
+    encode_base64_branchy(binary, 16, expected);
+    
+    for(unsigned int position = 0; position < 24; ++position) {
+      unsigned char base64[25];
+      memcpy(base64, expected, 25);
+      base64[position] = '-';
+      
+      unsigned int expected_length = decode_base64_branchy(base64, actual);
+      REQUIRE(decode_base64<16>(base64, actual) == expected_length);
+      REQUIRE(memcmp(actual, binary, expected_length) == 0);
+      for(unsigned int i = expected_length; i < 16; ++i) REQUIRE(actual[i] == 0);
+    }
+  }
+  
+  SECTION("Character mapping matches the converters") {
+    for(unsigned int v = 0; v < 64; ++v) REQUIRE(base64_char(v) == binary_to_base64(v));
+    for(unsigned int c = 0; c < 256; ++c) REQUIRE(base64_value(c) == base64_to_binary(c));
+  }
+}
+#endif
+
+TEST_CASE("decode_base64_strict()", "[]") {
+  unsigned char actual[100];
+  
+  SECTION("Canonical input is decoded") {
+    unsigned char expected_binary_0[] = {3};
+    REQUIRE(decode_base64_strict((const unsigned char*) "Aw==", 4, actual, sizeof(actual)) == 1);
+    REQUIRE(memcmp(actual, expected_binary_0, 1) == 0);
+    
+    unsigned char expected_binary_1[] = {107, 248};
+    REQUIRE(decode_base64_strict((const unsigned char*) "a/g=", 4, actual, sizeof(actual)) == 2);
+    REQUIRE(memcmp(actual, expected_binary_1, 2) == 0);
+    
+    unsigned char expected_binary_2[] = {226, 127, 31, 206, 19, 75, 35, 80};
+    REQUIRE(decode_base64_strict((const unsigned char*) "4n8fzhNLI1A=", 12, actual, sizeof(actual)) == 8);
+    REQUIRE(memcmp(actual, expected_binary_2, 8) == 0);
+    
+    unsigned char expected_binary_3[] = {99, 225, 39, 195, 8, 43, 209, 151, 8, 43, 195, 183};
+    REQUIRE(decode_base64_strict((const unsigned char*) "Y+Enwwgr0ZcIK8O3", 16, actual, sizeof(actual)) == 12);
+    REQUIRE(memcmp(actual, expected_binary_3, 12) == 0);
+    
+    REQUIRE(decode_base64_strict((const unsigned char*) "", 0, actual, sizeof(actual)) == 0);
+  }
+  
+  SECTION("Malformed input is rejected") {
+    const char *inputs[] = {
+      "Aw", "Aw=", "Aw===", "a/g", "4n8fzhNLI1A", // Missing or extra padding
+      "AA==4n8fzhNL", "Aw=4n8fzhNL", "=AAA", "A===", // Padding in the middle
+      "4n8f zhNL", "4n8f-_NL", "4n8fzhN\x80", "4n8fzhN\xFF", // Non-base64 characters
+      "Ax==", "a/h=" // Unused bits set
+    };
+    
+    for(unsigned int i = 0; i < sizeof(inputs)/sizeof(inputs[0]); ++i) {
+      REQUIRE(decode_base64_strict((const unsigned char*) inputs[i], strlen(inputs[i]), actual, sizeof(actual)) == BASE64_INVALID);
+    }
+  }
+  
+  SECTION("Output capacity too small") {
+    REQUIRE(decode_base64_strict((const unsigned char*) "4n8fzhNLI1A=", 12, actual, 7) == BASE64_INVALID);
+  }
+  
+#if __cplusplus >= 201703L
+  SECTION("Fixed-size decode_base64_strict<N>()") {
+    unsigned char binary[18], base64[25];
+    for(unsigned int i = 0; i < 18; ++i) binary[i] = (unsigned char) (i*167 + 13);
+    
+    encode_base64_branchy(binary, 16, base64);
+    REQUIRE(decode_base64_strict<16>(base64, actual));
+    REQUIRE(memcmp(actual, binary, 16) == 0);
+    
+    for(unsigned int position = 0; position < 24; ++position) {
+      unsigned char saved = base64[position];
+      base64[position] = position < 22 ? '=' : 'A';
+      REQUIRE_FALSE(decode_base64_strict<16>(base64, actual));
+      base64[position] = saved;
+    }
+    
+    base64[21] = binary_to_base64(base64_to_binary(base64[21]) | 1); // Unused bits before "=="
+    REQUIRE_FALSE(decode_base64_strict<16>(base64, actual));
+    
+    encode_base64_branchy(binary, 17, base64);
+    REQUIRE(decode_base64_strict<17>(base64, actual));
+    REQUIRE(memcmp(actual, binary, 17) == 0);
+    
+    encode_base64_branchy(binary, 18, base64);
+    REQUIRE(decode_base64_strict<18>(base64, actual));
+    REQUIRE(memcmp(actual, binary, 18) == 0);
+    base64[23] = '-';
+    REQUIRE_FALSE(decode_base64_strict<18>(base64, actual));
+  }
+#endif
+}
+
+#if __cplusplus >= 201703L
+// Checks a policy against the RFC 4648 test vectors (as expected for that policy's alphabet and padding)
+template <typename Policy>
+void check_policy(const char *const vectors[][2], unsigned int count) {
+  typedef base64_codec<Policy> codec;
+  unsigned char actual[100];
+  
+  for(unsigned int i = 0; i < count; ++i) {
+    const unsigned char *binary = (const unsigned char*) vectors[i][0];
+    const unsigned char *base64 = (const unsigned char*) vectors[i][1];
+    size_t binary_length = strlen(vectors[i][0]), base64_length = strlen(vectors[i][1]);
+    
+    REQUIRE(codec::encoded_length(binary_length) == base64_length);
+    REQUIRE(codec::encode(binary, binary_length, actual) == base64_length);
+    REQUIRE(memcmp(actual, base64, base64_length + 1) == 0);
+    
+    REQUIRE(codec::decoded_length(base64, base64_length) == binary_length);
+    REQUIRE(codec::decode(base64, base64_length, actual, sizeof(actual)) == binary_length);
+    REQUIRE(memcmp(actual, binary, binary_length) == 0);
+    
+    REQUIRE(codec::decode_strict(base64, base64_length, actual, sizeof(actual)) == binary_length);
+    REQUIRE(memcmp(actual, binary, binary_length) == 0);
+  }
+  
+  // Fixed-size forms, all three remainders
+  const unsigned char *binary = (const unsigned char*) vectors[count - 1][0];
+  codec::encode(binary, 4, actual);
+  encode_base64<4, Policy>(binary, actual + 50);
+  REQUIRE((memcmp(actual + 50, actual, base64_encoded_size<4, Policy>) == 0));
+  REQUIRE((decode_base64<4, Policy>(actual, actual + 50) == 4));
+  REQUIRE((decode_base64_strict<4, Policy>(actual, actual + 50)));
+  REQUIRE(memcmp(actual + 50, binary, 4) == 0);
+  
+  codec::encode(binary, 5, actual);
+  encode_base64<5, Policy>(binary, actual + 50);
+  REQUIRE((memcmp(actual + 50, actual, base64_encoded_size<5, Policy>) == 0));
+  REQUIRE((decode_base64<5, Policy>(actual, actual + 50) == 5));
+  REQUIRE((decode_base64_strict<5, Policy>(actual, actual + 50)));
+  REQUIRE(memcmp(actual + 50, binary, 5) == 0);
+  
+  codec::encode(binary, 6, actual);
+  encode_base64<6, Policy>(binary, actual + 50);
+  REQUIRE((memcmp(actual + 50, actual, base64_encoded_size<6, Policy>) == 0));
+  REQUIRE((decode_base64<6, Policy>(actual, actual + 50) == 6));
+  REQUIRE((decode_base64_strict<6, Policy>(actual, actual + 50)));
+  REQUIRE(memcmp(actual + 50, binary, 6) == 0);
+}
+
+template <typename Policy>
+size_t strict_length(const char *base64) {
+  unsigned char actual[100];
+  return base64_codec<Policy>::decode_strict((const unsigned char*) base64, strlen(base64), actual, sizeof(actual));
+}
+
+TEST_CASE("Alphabet and padding policies", "[]") {
+  SECTION("base64_standard") {
+    const char *const vectors[][2] = {
+      {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"}, {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="},
+      {"\xFB\xFF", "+/8="}, {"\xFF\xFF\xFE", "///+"}, {"foobar", "Zm9vYmFy"}
+    };
+    check_policy<base64_standard>(vectors, sizeof(vectors)/sizeof(vectors[0]));
+    
+    REQUIRE(strict_length<base64_standard>("Zg") == BASE64_INVALID);
+    REQUIRE(strict_length<base64_standard>("-_8=") == BASE64_INVALID);
+  }
+  
+  SECTION("base64_standard_unpadded") {
+    const char *const vectors[][2] = {
+      {"", ""}, {"f", "Zg"}, {"fo", "Zm8"}, {"foo", "Zm9v"}, {"foob", "Zm9vYg"}, {"fooba", "Zm9vYmE"},
+      {"\xFB\xFF", "+/8"}, {"\xFF\xFF\xFE", "///+"}, {"foobar", "Zm9vYmFy"}
+    };
+    check_policy<base64_standard_unpadded>(vectors, sizeof(vectors)/sizeof(vectors[0]));
+    
+    REQUIRE(strict_length<base64_standard_unpadded>("Zg==") == BASE64_INVALID);
+    REQUIRE(strict_length<base64_standard_unpadded>("Zm9vY") == BASE64_INVALID);
+    REQUIRE(strict_length<base64_standard_unpadded>("Zh") == BASE64_INVALID);
+  }
+  
+  SECTION("base64_url") {
+    const char *const vectors[][2] = {
+      {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"}, {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="},
+      {"\xFB\xFF", "-_8="}, {"\xFF\xFF\xFE", "___-"}, {"foobar", "Zm9vYmFy"}
+    };
+    check_policy<base64_url>(vectors, sizeof(vectors)/sizeof(vectors[0]));
+    
+    REQUIRE(strict_length<base64_url>("+/8=") == BASE64_INVALID);
+    REQUIRE(strict_length<base64_url>("Zm8") == BASE64_INVALID);
+  }
+  
+  SECTION("base64_url_unpadded") {
+    const char *const vectors[][2] = {
+      {"", ""}, {"f", "Zg"}, {"fo", "Zm8"}, {"foo", "Zm9v"}, {"foob", "Zm9vYg"}, {"fooba", "Zm9vYmE"},
+      {"\xFB\xFF", "-_8"}, {"\xFF\xFF\xFE", "___-"}, {"foobar", "Zm9vYmFy"}
+    };
+    check_policy<base64_url_unpadded>(vectors, sizeof(vectors)/sizeof(vectors[0]));
+    
+    REQUIRE(strict_length<base64_url_unpadded>("+/8") == BASE64_INVALID);
+    REQUIRE(strict_length<base64_url_unpadded>("Zm8=") == BASE64_INVALID);
+  }
+  
+  SECTION("base64_standard matches the C API") {
+    unsigned char binary[200], expected[300], actual[300];
+    for(unsigned int i = 0; i < 200; ++i) binary[i] = (unsigned char) (i*167 + 13);
+    
+    for(unsigned int length = 0; length <= 200; ++length) {
+      unsigned int expected_length = encode_base64_branchy(binary, length, expected);
+      REQUIRE(base64_codec<base64_standard>::encode(binary, length, actual) == expected_length);
+      REQUIRE(memcmp(actual, expected, expected_length + 1) == 0);
+    }
+  }
+}
+
+static_assert(base64_encoded_size<16, base64_url_unpadded> == 22, "unpadded signature length");
+static_assert(decode_base64<2, base64_url_unpadded>("-_8")[0] == 0xFB, "URL-safe decode at compile time");
+static_assert(encode_base64<base64_url>(fixed_binary)[9] == '-', "URL-safe encode at compile time");
+#endif
+
+TEST_CASE("In-place encode and decode", "[]") {
+  unsigned char binary[300];
+  unsigned char expected[420], buffer[420];
+  
+  for(unsigned int i = 0; i < 300; ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  SECTION("encode_base64_inplace() for every remainder") {
+    for(unsigned int length = 0; length <= 300; ++length) {
+      unsigned int expected_length = encode_base64_branchy(binary, length, expected);
+      
+      memset(buffer, 0xAA, sizeof(buffer));
+      memcpy(buffer, binary, length);
+      
+      REQUIRE(encode_base64_inplace(buffer, length) == expected_length);
+      REQUIRE(memcmp(buffer, expected, expected_length + 1) == 0);
+    }
+  }
+  
+  SECTION("decode_base64_inplace() for every remainder, padded or not") {
+    for(unsigned int length = 0; length <= 300; ++length) {
+      unsigned int base64_length = encode_base64_branchy(binary, length, expected);
+      
+      for(unsigned int padding = 0; padding < 2; ++padding) {
+        // Unpadded strings end with 2 or 3 characters in the last group
+        unsigned int chars = base64_length;
+        if(padding == 0) while(chars > 0 && expected[chars - 1] == '=') --chars;
+        
+        memcpy(buffer, expected, chars);
+        buffer[chars] = '\0';
+        REQUIRE(decode_base64_inplace(buffer) == length);
+        REQUIRE(memcmp(buffer, binary, length) == 0);
+        
+        memcpy(buffer, expected, chars);
+        REQUIRE(decode_base64_inplace(buffer, (size_t) chars) == length);
+        REQUIRE(memcmp(buffer, binary, length) == 0);
+      }
+    }
+  }
+  
+  SECTION("Every decode kernel tolerates aliasing") {
+    for(unsigned int length = 0; length <= 300; length += 7) {
+      unsigned int base64_length = encode_base64_branchy(binary, length, expected);
+      
+      memcpy(buffer, expected, base64_length + 1);
+      REQUIRE(decode_base64_branchy(buffer, buffer) == length);
+      REQUIRE(memcmp(buffer, binary, length) == 0);
+      
+      memcpy(buffer, expected, base64_length + 1);
+      REQUIRE(decode_base64_table(buffer, buffer) == length);
+      REQUIRE(memcmp(buffer, binary, length) == 0);
+      
+#ifdef BASE64_HAVE_X86_SIMD
+      if(base64_simd_level() >= BASE64_SIMD_SSE41) {
+        memcpy(buffer, expected, base64_length + 1);
+        REQUIRE(decode_base64_sse41(buffer, buffer) == length);
+        REQUIRE(memcmp(buffer, binary, length) == 0);
+      }
+      
+      if(base64_simd_level() >= BASE64_SIMD_AVX2) {
+        memcpy(buffer, expected, base64_length + 1);
+        REQUIRE(decode_base64_avx2(buffer, buffer) == length);
+        REQUIRE(memcmp(buffer, binary, length) == 0);
+      }
+#endif
+    }
+  }
+}
+
+TEST_CASE("Z85 encode and decode", "[]") {
+  // Test vectors from ZeroMQ RFC 32
+  unsigned char hello[] = {0x86, 0x4F, 0xD2, 0x6F, 0xB5, 0x59, 0xF7, 0x5B};
+  unsigned char key[] = {
+    0x8E, 0x0B, 0xDD, 0x69, 0x76, 0x28, 0xB9, 0x1D, 0x8F, 0x24, 0x55, 0x87, 0xEE, 0x95, 0xC5, 0xB0,
+    0x4D, 0x48, 0x96, 0x3F, 0x79, 0x25, 0x98, 0x77, 0xB4, 0x9C, 0xD9, 0x06, 0x3A, 0xEA, 0xD3, 0xB7
+  };
+  const char *key_z85 = "JTKVSB%%)wK0E.X)V>+}o?pNmC{O&4W4b!Ni{Lh6";
+  
+  unsigned char binary[64], actual[128], expected[128];
+  for(unsigned int i = 0; i < 64; ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  SECTION("encode_z85_length()") {
+    REQUIRE(encode_z85_length(0) == 0);
+    REQUIRE(encode_z85_length(4) == 5);
+    REQUIRE(encode_z85_length(16) == 20);
+    REQUIRE(encode_z85_length(32) == 40);
+  }
+  
+  SECTION("RFC 32 vectors") {
+    REQUIRE(encode_z85(hello, 8, actual) == 10);
+    REQUIRE(strcmp((char *) actual, "HelloWorld") == 0);
+    REQUIRE(encode_z85(key, 32, actual) == 40);
+    REQUIRE(strcmp((char *) actual, key_z85) == 0);
+    
+    REQUIRE(decode_z85_length((unsigned char *) "HelloWorld") == 8);
+    REQUIRE(decode_z85((unsigned char *) "HelloWorld", actual) == 8);
+    REQUIRE(memcmp(actual, hello, 8) == 0);
+    REQUIRE(decode_z85((unsigned char *) key_z85, actual) == 32);
+    REQUIRE(memcmp(actual, key, 32) == 0);
+  }
+  
+  SECTION("Group value range") {
+    REQUIRE(decode_z85((const unsigned char *) "00000", 5, actual, 4) == 4);
+    REQUIRE(memcmp(actual, "\0\0\0\0", 4) == 0);
+    REQUIRE(decode_z85((const unsigned char *) "%nSc0", 5, actual, 4) == 4);
+    REQUIRE(memcmp(actual, "\xFF\xFF\xFF\xFF", 4) == 0);
+    
+    // Above 0xFFFFFFFF
+    REQUIRE(decode_z85((const unsigned char *) "%nSc1", 5, actual, 4) == Z85_INVALID);
+    REQUIRE(decode_z85((const unsigned char *) "#####", 5, actual, 4) == Z85_INVALID);
+    REQUIRE(decode_z85((unsigned char *) "00000%nSc1", actual) == 4);
+    REQUIRE(decode_z85_length((unsigned char *) "00000%nSc1") == 4);
+  }
+  
+  SECTION("Invalid input") {
+    // Lengths that are not a multiple of 4
+    REQUIRE(encode_z85(binary, 5, actual) == 0);
+    REQUIRE(actual[0] == '\0');
+    
+    REQUIRE(decode_z85((const unsigned char *) "Hello", 5, actual, 4) == 4);
+    REQUIRE(decode_z85((const unsigned char *) "Hello", 5, actual, 3) == Z85_INVALID);
+    REQUIRE(decode_z85((const unsigned char *) "HelloWorl", 9, actual, 8) == Z85_INVALID);
+    REQUIRE(decode_z85((const unsigned char *) "Hello Worl", 10, actual, 8) == Z85_INVALID);
+    REQUIRE(decode_z85((const unsigned char *) "Hello\"orld", 10, actual, 8) == Z85_INVALID);
+    
+    // Null-terminated decoding stops at the first incomplete or invalid group
+    REQUIRE(decode_z85((unsigned char *) "HelloWorl", actual) == 4);
+    REQUIRE(decode_z85((unsigned char *) "Hel~oWorld", actual) == 0);
+    REQUIRE(decode_z85((unsigned char *) "HelloWor,d", actual) == 4);
+    REQUIRE(memcmp(actual, hello, 4) == 0);
+    REQUIRE(decode_z85_length((unsigned char *) "HelloWor,d") == 4);
+  }
+  
+  SECTION("Streaming encoder and decoder match for every chunk size") {
+    for(unsigned int length = 0; length <= 64; length += 4) {
+      unsigned int z85_length = encode_z85(binary, length, expected);
+      
+      for(unsigned int chunk = 1; chunk <= 13; ++chunk) {
+        z85_encoder encoder;
+        z85_encoder_init(&encoder);
+        unsigned int written = 0;
+        for(unsigned int offset = 0; offset < length; offset += chunk) {
+          written += z85_encoder_update(&encoder, binary + offset, chunk < length - offset ? chunk : length - offset, actual + written);
+        }
+        REQUIRE(z85_encoder_finish(&encoder) == 1);
+        REQUIRE(written == z85_length);
+        REQUIRE(memcmp(actual, expected, z85_length) == 0);
+        
+        z85_decoder decoder;
+        z85_decoder_init(&decoder);
+        written = 0;
+        for(unsigned int offset = 0; offset < z85_length; offset += chunk) {
+          written += z85_decoder_update(&decoder, expected + offset, chunk < z85_length - offset ? chunk : z85_length - offset, actual + written);
+        }
+        REQUIRE(z85_decoder_finish(&decoder) == 1);
+        REQUIRE(written == length);
+        REQUIRE(memcmp(actual, binary, length) == 0);
+      }
+    }
+    
+    z85_encoder encoder;
+    z85_encoder_init(&encoder);
+    REQUIRE(z85_encoder_update(&encoder, binary, 6, actual) == 5);
+    REQUIRE(z85_encoder_finish(&encoder) == 0);
+    
+    z85_decoder decoder;
+    z85_decoder_init(&decoder);
+    REQUIRE(z85_decoder_update(&decoder, (const unsigned char *) "HelloWor", 8, actual) == 4);
+    REQUIRE(z85_decoder_finish(&decoder) == 0);
+    
+    z85_decoder_init(&decoder);
+    REQUIRE(z85_decoder_update(&decoder, (const unsigned char *) "Hello#####World", 15, actual) == 4);
+    REQUIRE(z85_decoder_update(&decoder, (const unsigned char *) "Hello", 5, actual) == 0);
+    REQUIRE(z85_decoder_finish(&decoder) == 0);
+  }
+  
+  SECTION("Fixed-size encode_z85<N>() and decode_z85<N>()") {
+    static_assert(z85_encoded_size<16> == 20, "");
+    
+    for(unsigned int offset = 0; offset <= 48; offset += 4) {
+      encode_z85(binary + offset, 16, expected);
+      encode_z85<16>(binary + offset, actual);
+      REQUIRE(memcmp(actual, expected, 20) == 0);
+      
+      REQUIRE(decode_z85<16>(expected, actual));
+      REQUIRE(memcmp(actual, binary + offset, 16) == 0);
+      REQUIRE(decode_z85<16>((const char *) expected, actual));
+    }
+    
+    REQUIRE(decode_z85<8>("HelloWorld", actual));
+    REQUIRE(memcmp(actual, hello, 8) == 0);
+    REQUIRE_FALSE(decode_z85<8>("HelloWor d", actual));
+    REQUIRE_FALSE(decode_z85<8>("Hello%nSc1", actual));
+    REQUIRE(decode_z85<8>("%nSc0%nSc0", actual));
+  }
+}
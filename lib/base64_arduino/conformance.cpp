@@ -0,0 +1,578 @@
+// Differential conformance harness and performance gate for the base64 kernels. Build and run with
+// `make conformance`
+//
+// Every kernel and entry point (table, SWAR, SIMD, dispatching, in-place, streaming, length-delimited,
+// strict, fixed-size and the alphabet/padding policies) is checked against the reference
+// encode_base64_branchy()/decode_base64_branchy() on the same input, and any mismatch aborts with the input
+// printed. The checks live in LLVMFuzzerTestOneInput(), so building with -DBASE64_FUZZER and
+// -fsanitize=fuzzer turns this file into a libFuzzer target (`make fuzz`). Otherwise main() feeds it random
+// and adversarial inputs (padding in the middle, extra padding, characters outside the alphabet, truncation),
+// then times each kernel against the reference and fails if any is slower. The Z85 entry points are checked
+// the same way against encode_z85()/decode_z85()
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "base64.hpp"
+#include "z85.hpp"
+
+static const unsigned char *current_input;
+static size_t current_length;
+
+static void mismatch(const char *kernel, const char *what) {
+  fprintf(stderr, "%s: %s differs from the reference for input (%zu bytes):\n", kernel, what, current_length);
+  for(size_t i = 0; i < current_length; ++i) fprintf(stderr, "%02x", current_input[i]);
+  fprintf(stderr, "\n");
+  abort();
+}
+
+static void expect_bytes(const char *kernel, const unsigned char *actual, const unsigned char *expected, size_t length) {
+  if(length > 0 && memcmp(actual, expected, length) != 0) mismatch(kernel, "output");
+}
+
+static void expect_length(const char *kernel, size_t actual, size_t expected) {
+  if(actual != expected) mismatch(kernel, "returned length");
+}
+
+// Binary sizes the fixed-size codec is instantiated for
+template <size_t... N>
+struct fixed_sizes {};
+
+typedef fixed_sizes<1, 2, 3, 4, 5, 16, 32> checked_fixed_sizes;
+
+template <size_t N>
+static void check_fixed_encode(const unsigned char data[], size_t size) {
+  if(size < N) return;
+  
+  unsigned char expected[base64_encoded_size<N> + 1], actual[base64_encoded_size<N> + 1];
+  encode_base64_branchy((unsigned char *) data, N, expected);
+  
+  encode_base64<N>(data, actual);
+  expect_bytes("encode_base64<N>", actual, expected, base64_encoded_size<N>);
+}
+
+template <size_t... N>
+static void check_fixed_encode(const unsigned char data[], size_t size, fixed_sizes<N...>) {
+  int expand[] = {0, (check_fixed_encode<N>(data, size), 0)...};
+  (void) expand;
+}
+
+// Runs data through every encoder
+static void check_encode(const unsigned char data[], size_t size) {
+  std::vector<unsigned char> input(data, data + size);
+  
+  size_t encoded_length = encode_base64_length(size);
+  std::vector<unsigned char> expected(encoded_length + 1), actual(encoded_length + 1);
+  
+  expect_length("encode_base64_branchy", encode_base64_branchy(input.data(), size, expected.data()), encoded_length);
+  
+  struct { const char *name; unsigned int (*encode)(unsigned char[], unsigned int, unsigned char[]); int simd_level; } encoders[] = {
+    {"encode_base64_table", encode_base64_table, BASE64_SIMD_NONE},
+    {"encode_base64_swar", encode_base64_swar, BASE64_SIMD_NONE},
+#ifdef BASE64_HAVE_X86_SIMD
+    {"encode_base64_sse41", encode_base64_sse41, BASE64_SIMD_SSE41},
+    {"encode_base64_avx2", encode_base64_avx2, BASE64_SIMD_AVX2},
+#endif
+    {"encode_base64", encode_base64, BASE64_SIMD_NONE},
+  };
+  
+  for(size_t k = 0; k < sizeof(encoders)/sizeof(encoders[0]); ++k) {
+    if(encoders[k].simd_level > base64_simd_level()) continue;
+    expect_length(encoders[k].name, encoders[k].encode(input.data(), size, actual.data()), encoded_length);
+    expect_bytes(encoders[k].name, actual.data(), expected.data(), encoded_length + 1);
+  }
+  
+  // In place
+  std::copy(data, data + size, actual.begin());
+  expect_length("encode_base64_inplace", encode_base64_inplace(actual.data(), size), encoded_length);
+  expect_bytes("encode_base64_inplace", actual.data(), expected.data(), encoded_length + 1);
+  
+  // Streaming, in chunks of varying size
+  base64_encoder encoder;
+  base64_encoder_init(&encoder);
+  size_t written = 0;
+  for(size_t offset = 0, chunk = 1; offset < size; offset += chunk, chunk = chunk*7 % 23 + 1) {
+    chunk = std::min(chunk, size - offset);
+    written += base64_encoder_update(&encoder, data + offset, chunk, actual.data() + written);
+  }
+  written += base64_encoder_finish(&encoder, actual.data() + written);
+  expect_length("base64_encoder", written, encoded_length);
+  expect_bytes("base64_encoder", actual.data(), expected.data(), encoded_length + 1);
+  
+  // Policies: the URL alphabet swaps the last two characters, unpadded ones drop the '='
+  std::string url, unpadded;
+  for(size_t i = 0; i < encoded_length; ++i) {
+    unsigned char c = expected[i];
+    url += c == '+' ? '-' : c == '/' ? '_' : c;
+    if(c != '=') unpadded += c;
+  }
+  
+  expect_length("base64_codec<base64_standard>::encode", base64_codec<base64_standard>::encode(data, size, actual.data()), encoded_length);
+  expect_bytes("base64_codec<base64_standard>::encode", actual.data(), expected.data(), encoded_length + 1);
+  
+  expect_length("base64_codec<base64_url>::encode", base64_codec<base64_url>::encode(data, size, actual.data()), encoded_length);
+  expect_bytes("base64_codec<base64_url>::encode", actual.data(), (const unsigned char *) url.c_str(), encoded_length + 1);
+  
+  expect_length("base64_codec<base64_standard_unpadded>::encode",
+                base64_codec<base64_standard_unpadded>::encode(data, size, actual.data()), unpadded.size());
+  expect_bytes("base64_codec<base64_standard_unpadded>::encode", actual.data(),
+               (const unsigned char *) unpadded.c_str(), unpadded.size() + 1);
+  
+  check_fixed_encode(data, size, checked_fixed_sizes());
+}
+
+// Canonical encodings are the only input decode_base64_strict() accepts: the reference must re-encode the
+// decoded bytes to exactly the same characters
+static bool canonical(const unsigned char text[], size_t length, const unsigned char decoded[], size_t decoded_length) {
+  std::vector<unsigned char> encoded(encode_base64_length(decoded_length) + 1);
+  size_t encoded_length = encode_base64_branchy((unsigned char *) decoded, decoded_length, encoded.data());
+  return encoded_length == length && (length == 0 || memcmp(encoded.data(), text, length) == 0);
+}
+
+// Reference decode of a string that need not be null-terminated
+static std::vector<unsigned char> reference_decode(const unsigned char text[], size_t length) {
+  std::vector<unsigned char> input(text, text + length);
+  input.resize(length + 1);
+  
+  std::vector<unsigned char> output(length + 1);
+  output.resize(decode_base64_branchy(input.data(), output.data()));
+  return output;
+}
+
+template <size_t N>
+static void check_fixed_decode(const unsigned char text[], size_t length) {
+  const size_t characters = base64_encoded_size<N>;
+  if(length < characters) return;
+  
+  std::vector<unsigned char> expected = reference_decode(text, characters);
+  size_t expected_length = std::min(N, expected.size());
+  
+  unsigned char actual[N];
+  expect_length("decode_base64<N>", decode_base64<N>(text, actual), expected_length);
+  expect_bytes("decode_base64<N>", actual, expected.data(), expected_length);
+  for(size_t i = expected_length; i < N; ++i) {
+    if(actual[i] != 0) mismatch("decode_base64<N>", "masked byte");
+  }
+  
+  bool valid = expected.size() == N && canonical(text, characters, expected.data(), N);
+  if(decode_base64_strict<N>(text, actual) != valid) mismatch("decode_base64_strict<N>", "validity");
+  if(valid) expect_bytes("decode_base64_strict<N>", actual, expected.data(), N);
+}
+
+template <size_t... N>
+static void check_fixed_decode(const unsigned char text[], size_t length, fixed_sizes<N...>) {
+  int expand[] = {0, (check_fixed_decode<N>(text, length), 0)...};
+  (void) expand;
+}
+
+// Runs text through every decoder. text may contain nulls and any other character
+static void check_decode(const unsigned char text[], size_t length) {
+  std::vector<unsigned char> input(text, text + length);
+  input.resize(length + 1);
+  
+  std::vector<unsigned char> expected(length + 1), actual(length + 1);
+  size_t expected_length = decode_base64_branchy(input.data(), expected.data());
+  expect_length("decode_base64_length_branchy", decode_base64_length_branchy(input.data()), expected_length);
+  
+  struct {
+    const char *name;
+    unsigned int (*decode)(unsigned char[], unsigned char[]);
+    unsigned int (*decode_length)(unsigned char[]);
+    int simd_level;
+  } decoders[] = {
+    {"decode_base64_table", decode_base64_table, decode_base64_length_table, BASE64_SIMD_NONE},
+#ifdef BASE64_HAVE_X86_SIMD
+    {"decode_base64_sse41", decode_base64_sse41, decode_base64_length_sse41, BASE64_SIMD_SSE41},
+    {"decode_base64_avx2", decode_base64_avx2, decode_base64_length_avx2, BASE64_SIMD_AVX2},
+#endif
+    {"decode_base64", decode_base64, decode_base64_length, BASE64_SIMD_NONE},
+  };
+  
+  for(size_t k = 0; k < sizeof(decoders)/sizeof(decoders[0]); ++k) {
+    if(decoders[k].simd_level > base64_simd_level()) continue;
+    expect_length(decoders[k].name, decoders[k].decode_length(input.data()), expected_length);
+    expect_length(decoders[k].name, decoders[k].decode(input.data(), actual.data()), expected_length);
+    expect_bytes(decoders[k].name, actual.data(), expected.data(), expected_length);
+  }
+  
+  // In place, null-terminated and length-delimited
+  std::vector<unsigned char> buffer(input);
+  expect_length("decode_base64_inplace", decode_base64_inplace(buffer.data()), expected_length);
+  expect_bytes("decode_base64_inplace", buffer.data(), expected.data(), expected_length);
+  
+  buffer = input;
+  expect_length("decode_base64_inplace (length)", decode_base64_inplace(buffer.data(), length), expected_length);
+  expect_bytes("decode_base64_inplace (length)", buffer.data(), expected.data(), expected_length);
+  
+  // Length-delimited, also through the standard policy
+  expect_length("decode_base64 (length)", decode_base64(text, length, actual.data(), length), expected_length);
+  expect_bytes("decode_base64 (length)", actual.data(), expected.data(), expected_length);
+  
+  expect_length("base64_codec<base64_standard>::decode",
+                base64_codec<base64_standard>::decode(text, length, actual.data(), length), expected_length);
+  expect_bytes("base64_codec<base64_standard>::decode", actual.data(), expected.data(), expected_length);
+  
+  expect_length("base64_codec<base64_standard_unpadded>::decode",
+                base64_codec<base64_standard_unpadded>::decode(text, length, actual.data(), length), expected_length);
+  expect_bytes("base64_codec<base64_standard_unpadded>::decode", actual.data(), expected.data(), expected_length);
+  
+  // Streaming, in chunks of varying size
+  base64_decoder decoder;
+  base64_decoder_init(&decoder);
+  size_t written = 0;
+  for(size_t offset = 0, chunk = 1; offset < length; offset += chunk, chunk = chunk*5 % 19 + 1) {
+    chunk = std::min(chunk, length - offset);
+    written += base64_decoder_update(&decoder, text + offset, chunk, actual.data() + written);
+  }
+  written += base64_decoder_finish(&decoder, actual.data() + written);
+  expect_length("base64_decoder", written, expected_length);
+  expect_bytes("base64_decoder", actual.data(), expected.data(), expected_length);
+  
+  // Strict decoding accepts exactly the canonical encodings
+  bool valid = canonical(text, length, expected.data(), expected_length);
+  size_t strict_length = valid ? expected_length : BASE64_INVALID;
+  
+  size_t result = decode_base64_strict(text, length, actual.data(), length);
+  expect_length("decode_base64_strict", result, strict_length);
+  if(valid) expect_bytes("decode_base64_strict", actual.data(), expected.data(), expected_length);
+  
+  result = base64_codec<base64_standard>::decode_strict(text, length, actual.data(), length);
+  expect_length("base64_codec<base64_standard>::decode_strict", result, strict_length);
+  if(valid) expect_bytes("base64_codec<base64_standard>::decode_strict", actual.data(), expected.data(), expected_length);
+  
+  // Unpadded strict decoding accepts the canonical encodings with their padding removed
+  std::vector<unsigned char> padded(text, text + length);
+  padded.insert(padded.end(), (4 - length % 4) % 4, '=');
+  std::vector<unsigned char> padded_expected = reference_decode(padded.data(), padded.size());
+  bool valid_unpadded = length % 4 != 1 && std::find(text, text + length, '=') == text + length &&
+                        canonical(padded.data(), padded.size(), padded_expected.data(), padded_expected.size());
+  
+  result = base64_codec<base64_standard_unpadded>::decode_strict(text, length, actual.data(), length);
+  expect_length("base64_codec<base64_standard_unpadded>::decode_strict", result,
+                valid_unpadded ? padded_expected.size() : BASE64_INVALID);
+  if(valid_unpadded) {
+    expect_bytes("base64_codec<base64_standard_unpadded>::decode_strict", actual.data(), padded_expected.data(),
+                 padded_expected.size());
+  }
+  
+  // The URL alphabet: swapping its last two characters back (and making '+', '/' invalid) must give the same
+  // result through the reference
+  std::vector<unsigned char> standard(text, text + length);
+  for(size_t i = 0; i < length; ++i) {
+    unsigned char c = text[i];
+    standard[i] = c == '-' ? '+' : c == '_' ? '/' : c == '+' || c == '/' ? '!' : c;
+  }
+  std::vector<unsigned char> url_expected = reference_decode(standard.data(), length);
+  
+  expect_length("base64_codec<base64_url>::decode",
+                base64_codec<base64_url>::decode(text, length, actual.data(), length), url_expected.size());
+  expect_bytes("base64_codec<base64_url>::decode", actual.data(), url_expected.data(), url_expected.size());
+  
+  bool valid_url = canonical(standard.data(), length, url_expected.data(), url_expected.size());
+  result = base64_codec<base64_url>::decode_strict(text, length, actual.data(), length);
+  expect_length("base64_codec<base64_url>::decode_strict", result, valid_url ? url_expected.size() : BASE64_INVALID);
+  if(valid_url) expect_bytes("base64_codec<base64_url>::decode_strict", actual.data(), url_expected.data(), url_expected.size());
+  
+  check_fixed_decode(text, length, checked_fixed_sizes());
+}
+
+// Runs data, cut to a multiple of 4 bytes, through every Z85 encoder and back through every decoder
+static void check_z85_encode(const unsigned char data[], size_t size) {
+  size -= size % 4;
+  
+  size_t encoded_length = encode_z85_length(size);
+  std::vector<unsigned char> input(data, data + size);
+  std::vector<unsigned char> expected(encoded_length + 1), actual(encoded_length + 1);
+  
+  expect_length("encode_z85", encode_z85(input.data(), size, expected.data()), encoded_length);
+  
+  z85_encoder encoder;
+  z85_encoder_init(&encoder);
+  size_t written = 0;
+  for(size_t offset = 0, chunk = 1; offset < size; offset += chunk, chunk = chunk*7 % 23 + 1) {
+    chunk = std::min(chunk, size - offset);
+    written += z85_encoder_update(&encoder, data + offset, chunk, actual.data() + written);
+  }
+  if(!z85_encoder_finish(&encoder)) mismatch("z85_encoder", "completion");
+  expect_length("z85_encoder", written, encoded_length);
+  expect_bytes("z85_encoder", actual.data(), expected.data(), encoded_length);
+  
+  if(size >= 16) {
+    encode_z85<16>(data, actual.data());
+    expect_bytes("encode_z85<N>", actual.data(), expected.data(), z85_encoded_size<16>);
+  }
+  
+  std::vector<unsigned char> decoded(size + 4);
+  expect_length("decode_z85", decode_z85(expected.data(), decoded.data()), size);
+  expect_bytes("decode_z85", decoded.data(), data, size);
+  expect_length("decode_z85 (length)", decode_z85(expected.data(), encoded_length, decoded.data(), size), size);
+  expect_bytes("decode_z85 (length)", decoded.data(), data, size);
+}
+
+// Runs text through every Z85 decoder. text may contain nulls and any other character
+static void check_z85_decode(const unsigned char text[], size_t length) {
+  std::vector<unsigned char> input(text, text + length);
+  input.push_back('\0');
+  
+  std::vector<unsigned char> expected(length + 4), actual(length + 4);
+  size_t expected_length = decode_z85(input.data(), expected.data());
+  expect_length("decode_z85_length", decode_z85_length(input.data()), expected_length);
+  
+  // Without padding, input is either entirely valid or rejected
+  bool valid = length % 5 == 0 && expected_length == length/5*4;
+  
+  size_t result = decode_z85(text, length, actual.data(), actual.size());
+  expect_length("decode_z85 (length)", result, valid ? expected_length : Z85_INVALID);
+  if(valid) expect_bytes("decode_z85 (length)", actual.data(), expected.data(), expected_length);
+  
+  z85_decoder decoder;
+  z85_decoder_init(&decoder);
+  size_t written = 0;
+  for(size_t offset = 0, chunk = 1; offset < length; offset += chunk, chunk = chunk*5 % 19 + 1) {
+    chunk = std::min(chunk, length - offset);
+    written += z85_decoder_update(&decoder, text + offset, chunk, actual.data() + written);
+  }
+  if(z85_decoder_finish(&decoder) != valid) mismatch("z85_decoder", "validity");
+  expect_length("z85_decoder", written, expected_length);
+  expect_bytes("z85_decoder", actual.data(), expected.data(), expected_length);
+  
+  if(length >= z85_encoded_size<16>) {
+    bool valid_fixed = decode_z85(text, z85_encoded_size<16>, actual.data(), 16) == 16;
+    if(decode_z85<16>(text, actual.data()) != valid_fixed) mismatch("decode_z85<N>", "validity");
+    if(valid_fixed) expect_bytes("decode_z85<N>", actual.data(), expected.data(), 16);
+  }
+}
+
+// Each input is checked both as binary data to encode and as characters to decode
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  current_input = data;
+  current_length = size;
+  
+  check_encode(data, size);
+  check_decode(data, size);
+  check_z85_encode(data, size);
+  check_z85_decode(data, size);
+  
+  return 0;
+}
+
+#ifndef BASE64_FUZZER
+
+// Deterministic generator, so a failing run can be repeated with --seed
+static uint64_t random_state;
+
+static uint32_t random_next() {
+  random_state = random_state*6364136223846793005ULL + 1442695040888963407ULL;
+  return (uint32_t) (random_state >> 33);
+}
+
+static void check(const std::vector<unsigned char> &input) {
+  LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+// Encodings of random data, then damaged in the ways the Catch suite exercises one at a time
+static void check_random(unsigned int iterations) {
+  static const unsigned char odd_characters[] = {'=', '\0', '-', '_', '+', '/', ' ', '\n', '.', 0x80, 0xFF, 'A'};
+  
+  for(unsigned int i = 0; i < iterations; ++i) {
+    std::vector<unsigned char> binary(random_next() % 300);
+    for(size_t j = 0; j < binary.size(); ++j) binary[j] = random_next();
+    check(binary);
+    
+    std::vector<unsigned char> text(encode_base64_length(binary.size()) + 1);
+    text.resize(encode_base64_branchy(binary.data(), binary.size(), text.data()));
+    check(text);
+    
+    std::vector<unsigned char> damaged(text);
+    switch(random_next() % 6) {
+      case 0: // Odd characters (padding in the middle, outside the alphabet) at random positions
+        for(unsigned int n = random_next() % 4 + 1; n > 0 && !damaged.empty(); --n) {
+          damaged[random_next() % damaged.size()] = odd_characters[random_next() % sizeof(odd_characters)];
+        }
+        break;
+      case 1: // Extra padding
+        damaged.insert(damaged.end(), random_next() % 4 + 1, '=');
+        break;
+      case 2: // Truncated
+        damaged.resize(damaged.empty() ? 0 : random_next() % damaged.size());
+        break;
+      case 3: // Padding inserted in the middle
+        damaged.insert(damaged.begin() + (damaged.empty() ? 0 : random_next() % damaged.size()), random_next() % 3 + 1, '=');
+        break;
+      case 4: // Unused bits set before the padding
+        if(!damaged.empty() && damaged.back() == '=') {
+          size_t last = damaged.size() - (damaged[damaged.size() - 2] == '=' ? 3 : 2);
+          damaged[last] = binary_to_base64(base64_to_binary(damaged[last]) | 1);
+        }
+        break;
+      case 5: // Characters from the alphabet and the odd ones, in any order
+        for(size_t j = 0; j < damaged.size(); ++j) {
+          damaged[j] = random_next() % 8 ? binary_to_base64(random_next() % 64) : odd_characters[random_next() % sizeof(odd_characters)];
+        }
+        break;
+    }
+    check(damaged);
+    
+    // Z85 encodings, with a character replaced (outside the alphabet, or a group pushed above 32 bits)
+    std::vector<unsigned char> z85(encode_z85_length(binary.size()) + 1);
+    z85.resize(encode_z85(binary.data(), binary.size() - binary.size() % 4, z85.data()));
+    check(z85);
+    
+    if(!z85.empty()) {
+      z85[random_next() % z85.size()] = random_next() % 2 ? '#' : odd_characters[random_next() % sizeof(odd_characters)];
+      check(z85);
+    }
+  }
+}
+
+// Cases from the Catch suite, checked against every kernel rather than a fixed expected value
+static void check_corpus() {
+  static const char *corpus[] = {
+    "", "=", "==", "===", "====", "A", "AA", "AA=", "AA==", "AA===", "AAA", "AAA=", "AAA==", "AAAA", "AAAA=",
+    "AB=C", "A=BC", "QUJD=REVG", "QUJDRA====", "QUJDREU==", "QUJDREVG=", "Zm9v!YmFy", "Zm9v YmFy", "Zm9vYg",
+    "Zm9vYmE", "Zm9vYmFy", "-_-_", "+/+/", "AB==CD==", "Zh==", "Zm9=", "Zg==Zg==",
+    "HelloWorld", "HelloWorl", "%nSc0", "%nSc1", "#####", "00000%nSc1", "Hello World",
+  };
+  
+  for(size_t i = 0; i < sizeof(corpus)/sizeof(corpus[0]); ++i) {
+    check(std::vector<unsigned char>(corpus[i], corpus[i] + strlen(corpus[i])));
+  }
+  
+  // Every single byte value, alone and in the middle of valid groups
+  for(unsigned int c = 0; c < 256; ++c) {
+    for(unsigned int position = 0; position < 9; ++position) {
+      std::vector<unsigned char> text(8, 'Q');
+      text.insert(text.begin() + position, (unsigned char) c);
+      check(text);
+    }
+  }
+}
+
+static volatile size_t sink;
+
+static inline void clobber() {
+#if defined(__GNUC__)
+  asm volatile("" : : : "memory");
+#endif
+}
+
+// Fastest of several timed batches, in nanoseconds per call. The minimum is the least noisy estimate
+template <typename Call>
+static double fastest(Call call) {
+  double best = 1e300;
+  
+  for(unsigned int batch = 0; batch < 15; ++batch) {
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned int i = 0; i < 200; ++i) clobber(), call();
+    best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()/200);
+  }
+  
+  return best;
+}
+
+// Fails if a kernel is slower than the reference, beyond tolerance (a fraction of the reference time)
+static bool check_performance(double tolerance) {
+  static unsigned char binary[4096], base64[4096/3*4 + 5], output[4096];
+  static const unsigned int sizes[] = {16, 64, 256, 4096};
+  bool passed = true;
+  
+  for(unsigned int i = 0; i < sizeof(binary); ++i) binary[i] = (unsigned char) (i*167 + 13);
+  
+  // The SWAR encoder is meant for 32-bit targets without SIMD, it is only timed where it is the default
+  struct { const char *name; unsigned int (*encode)(unsigned char[], unsigned int, unsigned char[]); int simd_level; } encoders[] = {
+    {"encode_base64_table", encode_base64_table, BASE64_SIMD_NONE},
+#if defined(BASE64_PREFER_SWAR) && !defined(BASE64_HAVE_X86_SIMD)
+    {"encode_base64_swar", encode_base64_swar, BASE64_SIMD_NONE},
+#endif
+#ifdef BASE64_HAVE_X86_SIMD
+    {"encode_base64_sse41", encode_base64_sse41, BASE64_SIMD_SSE41},
+    {"encode_base64_avx2", encode_base64_avx2, BASE64_SIMD_AVX2},
+#endif
+    {"encode_base64", encode_base64, BASE64_SIMD_NONE},
+  };
+  
+  struct { const char *name; unsigned int (*decode)(unsigned char[], unsigned char[]); int simd_level; } decoders[] = {
+    {"decode_base64_table", decode_base64_table, BASE64_SIMD_NONE},
+#ifdef BASE64_HAVE_X86_SIMD
+    {"decode_base64_sse41", decode_base64_sse41, BASE64_SIMD_SSE41},
+    {"decode_base64_avx2", decode_base64_avx2, BASE64_SIMD_AVX2},
+#endif
+    {"decode_base64", decode_base64, BASE64_SIMD_NONE},
+  };
+  
+  for(unsigned int s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s) {
+    unsigned int size = sizes[s];
+    unsigned int length = encode_base64_table(binary, size, base64);
+    
+    double reference = fastest([&] { sink = encode_base64_branchy(binary, size, base64); });
+    for(size_t k = 0; k < sizeof(encoders)/sizeof(encoders[0]); ++k) {
+      if(encoders[k].simd_level > base64_simd_level()) continue;
+      double time = fastest([&] { sink = encoders[k].encode(binary, size, base64); });
+      printf("%-40s %6u bytes %10.1f ns (reference %10.1f ns)\n", encoders[k].name, size, time, reference);
+      if(time > reference*(1 + tolerance)) {
+        fprintf(stderr, "%s is slower than encode_base64_branchy() at %u bytes\n", encoders[k].name, size);
+        passed = false;
+      }
+    }
+    
+    reference = fastest([&] { sink = decode_base64_branchy(base64, output); });
+    for(size_t k = 0; k < sizeof(decoders)/sizeof(decoders[0]); ++k) {
+      if(decoders[k].simd_level > base64_simd_level()) continue;
+      double time = fastest([&] { sink = decoders[k].decode(base64, output); });
+      printf("%-40s %6u bytes %10.1f ns (reference %10.1f ns)\n", decoders[k].name, size, time, reference);
+      if(time > reference*(1 + tolerance)) {
+        fprintf(stderr, "%s is slower than decode_base64_branchy() at %u bytes\n", decoders[k].name, size);
+        passed = false;
+      }
+    }
+    
+    double time = fastest([&] { sink = decode_base64(base64, length, output, sizeof(output)); });
+    printf("%-40s %6u bytes %10.1f ns (reference %10.1f ns)\n", "decode_base64 (length)", size, time, reference);
+    if(time > reference*(1 + tolerance)) {
+      fprintf(stderr, "decode_base64 (length) is slower than decode_base64_branchy() at %u bytes\n", size);
+      passed = false;
+    }
+    
+    time = fastest([&] { sink = decode_base64_strict(base64, length, output, sizeof(output)); });
+    printf("%-40s %6u bytes %10.1f ns (reference %10.1f ns)\n", "decode_base64_strict", size, time, reference);
+    if(time > reference*(1 + tolerance)) {
+      fprintf(stderr, "decode_base64_strict is slower than decode_base64_branchy() at %u bytes\n", size);
+      passed = false;
+    }
+  }
+  
+  return passed;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: conformance [--iterations N] [--seed S] [--tolerance FRACTION] [--no-performance]\n");
+}
+
+int main(int argc, char **argv) {
+  unsigned int iterations = 20000;
+  double tolerance = 0.2;
+  bool performance = true;
+  random_state = 1;
+  
+  for(int i = 1; i < argc; ++i) {
+    if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = strtoul(argv[++i], 0, 10);
+    else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) random_state = strtoull(argv[++i], 0, 10);
+    else if(strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = strtod(argv[++i], 0);
+    else if(strcmp(argv[i], "--no-performance") == 0) performance = false;
+    else return usage(), 2;
+  }
+  
+  check_corpus();
+  check_random(iterations);
+  printf("All kernels match the reference (%u random inputs, SIMD level %d)\n", iterations, base64_simd_level());
+  
+  if(performance && !check_performance(tolerance)) return 1;
+  
+  return 0;
+}
+
+#endif // BASE64_FUZZER
@@ -5,6 +5,9 @@
 #ifndef BASE64_H_INCLUDED
 #define BASE64_H_INCLUDED
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* binary_to_base64:
  *   Description:
  *     Converts a single byte from a binary value to the corresponding base64 character
@@ -69,6 +72,226 @@ unsigned int encode_base64(unsigned char input[], unsigned int input_length, uns
  */
 unsigned int decode_base64(unsigned char input[], unsigned char output[]);
 
+/* encode_base64_branchy, encode_base64_table:
+ *   Description:
+ *     Kernels behind encode_base64(). The branchy kernel converts each character with binary_to_base64(),
+ *     the table kernel with a 64-entry alphabet lookup. Output is identical, parameters and return value are
+ *     the same as encode_base64()
+ */
+unsigned int encode_base64_branchy(unsigned char input[], unsigned int input_length, unsigned char output[]);
+unsigned int encode_base64_table(unsigned char input[], unsigned int input_length, unsigned char output[]);
+
+/* decode_base64_length_branchy, decode_base64_length_table:
+ *   Description:
+ *     Kernels behind decode_base64_length(). The branchy kernel classifies each character with base64_to_binary(),
+ *     the table kernel with a 256-entry reverse lookup. Parameters and return value are the same as
+ *     decode_base64_length()
+ */
+unsigned int decode_base64_length_branchy(unsigned char input[]);
+unsigned int decode_base64_length_table(unsigned char input[]);
+
+/* decode_base64_branchy, decode_base64_table:
+ *   Description:
+ *     Kernels behind decode_base64(). The branchy kernel converts each character with base64_to_binary(),
+ *     the table kernel with a 256-entry reverse lookup. Output is identical, parameters and return value are
+ *     the same as decode_base64()
+ */
+unsigned int decode_base64_branchy(unsigned char input[], unsigned char output[]);
+unsigned int decode_base64_table(unsigned char input[], unsigned char output[]);
+
+/* encode_base64_swar:
+ *   Description:
+ *     Word-at-a-time encoder for 32-bit targets without SIMD. Packs each 3-byte group into a 32-bit word and
+ *     maps its 4 6-bit values to ascii with shifts, masks and adds, without tables or per-character branches.
+ *     Output is identical to encode_base64(). Define BASE64_PREFER_SWAR to make it the encode_base64() kernel
+ *     on targets without SIMD kernels
+ *   Parameters and return value are the same as encode_base64()
+ */
+unsigned int encode_base64_swar(unsigned char input[], unsigned int input_length, unsigned char output[]);
+
+/* SIMD kernels (x86 hosts only):
+ *   Description:
+ *     SSE4.1 and AVX2 versions of the kernels, compiled when building for x86 with GCC or Clang unless
+ *     BASE64_NO_SIMD is defined. encode_base64(), decode_base64() and decode_base64_length() pick the best
+ *     one supported by the running CPU and fall back to the table kernels. Output is identical to the
+ *     table kernels, including the handling of invalid characters as padding
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && !defined(BASE64_NO_SIMD)
+  #define BASE64_HAVE_X86_SIMD 1
+  #include <string.h>
+  #include <immintrin.h>
+#endif
+
+#define BASE64_SIMD_NONE 0
+#define BASE64_SIMD_SSE41 1
+#define BASE64_SIMD_AVX2 2
+
+/* base64_simd_level:
+ *   Description:
+ *     Detects (once) the best SIMD kernel set supported by the running CPU
+ *   Returns:
+ *     BASE64_SIMD_AVX2, BASE64_SIMD_SSE41 or BASE64_SIMD_NONE
+ */
+int base64_simd_level(void);
+
+#ifdef BASE64_HAVE_X86_SIMD
+unsigned int encode_base64_sse41(unsigned char input[], unsigned int input_length, unsigned char output[]);
+unsigned int encode_base64_avx2(unsigned char input[], unsigned int input_length, unsigned char output[]);
+unsigned int decode_base64_length_sse41(unsigned char input[]);
+unsigned int decode_base64_length_avx2(unsigned char input[]);
+unsigned int decode_base64_sse41(unsigned char input[], unsigned char output[]);
+unsigned int decode_base64_avx2(unsigned char input[], unsigned char output[]);
+#endif
+
+/* encode_base64_inplace:
+ *   Description:
+ *     Converts the bytes at the start of a buffer to a base64 null-terminated string in the same buffer. Groups
+ *     are encoded from the end backwards, so no group overwrites input that has not been read yet
+ *   Parameters:
+ *     buffer - Input data on entry, base64 string on return. Must have room for
+ *              encode_base64_length(input_length) + 1 bytes
+ *     input_length - Number of bytes of input data at the start of buffer
+ *   Returns:
+ *     Length of encoded string in bytes (not including null terminator)
+ */
+unsigned int encode_base64_inplace(unsigned char buffer[], unsigned int input_length);
+
+/* decode_base64_inplace:
+ *   Description:
+ *     Converts a base64 null-terminated string to bytes in the same buffer. The output is written forwards and
+ *     never catches up with the input still to be read, whichever kernel decode_base64() uses
+ *   Parameters:
+ *     buffer - Base64 string on entry, decoded bytes (from the start) on return
+ *   Returns:
+ *     Number of bytes in the decoded binary
+ */
+unsigned int decode_base64_inplace(unsigned char buffer[]);
+
+/* base64_encoder, base64_decoder:
+ *   Description:
+ *     State of a streaming encode or decode. Input may be fed in chunks of any size, the partial 3-byte (or
+ *     4-character) group is carried across calls. Concatenating the outputs of every update and of finish
+ *     gives the same result as encode_base64() or decode_base64() on the whole input, so data of any size can
+ *     be processed with constant memory
+ */
+typedef struct {
+  unsigned char pending[3];
+  unsigned char pending_length;
+} base64_encoder;
+
+typedef struct {
+  unsigned char pending[3];
+  unsigned char pending_length;
+  unsigned char done; // Set once an invalid character (padding) has been seen, the rest is ignored
+} base64_decoder;
+
+/* base64_encoder_init, base64_decoder_init:
+ *   Description:
+ *     Resets the state to start a new encode or decode
+ */
+void base64_encoder_init(base64_encoder *encoder);
+void base64_decoder_init(base64_decoder *decoder);
+
+/* base64_encoder_update:
+ *   Description:
+ *     Encodes a chunk of binary data. Complete groups are written out, up to 2 trailing bytes are kept for the
+ *     next call
+ *   Parameters:
+ *     encoder - Encoder state
+ *     input - Pointer to input data
+ *     input_length - Number of bytes to read from input pointer
+ *     output - Pointer to output. Must have room for encode_base64_length(input_length) + 1 bytes (a null
+ *              terminator is added after the characters written)
+ *   Returns:
+ *     Number of base64 characters written (not including null terminator)
+ */
+unsigned int base64_encoder_update(base64_encoder *encoder, const unsigned char input[], unsigned int input_length, unsigned char output[]);
+
+/* base64_encoder_finish:
+ *   Description:
+ *     Writes the last, padded group if bytes are pending. The encoder must be reset before reuse
+ *   Parameters:
+ *     encoder - Encoder state
+ *     output - Pointer to output. Must have room for 5 bytes (4 characters and a null terminator)
+ *   Returns:
+ *     Number of base64 characters written, 0 or 4 (not including null terminator)
+ */
+unsigned int base64_encoder_finish(base64_encoder *encoder, unsigned char output[]);
+
+/* base64_decoder_update:
+ *   Description:
+ *     Decodes a chunk of base64 characters. Complete groups are written out, up to 3 trailing characters are
+ *     kept for the next call. After the first invalid character all further input is ignored
+ *   Parameters:
+ *     decoder - Decoder state
+ *     input - Pointer to input characters
+ *     input_length - Number of characters to read from input pointer
+ *     output - Pointer to output. Must have room for (input_length + 3)/4*3 bytes
+ *   Returns:
+ *     Number of bytes written
+ */
+unsigned int base64_decoder_update(base64_decoder *decoder, const unsigned char input[], unsigned int input_length, unsigned char output[]);
+
+/* base64_decoder_finish:
+ *   Description:
+ *     Writes the bytes of the last, incomplete group. The decoder must be reset before reuse
+ *   Parameters:
+ *     decoder - Decoder state
+ *     output - Pointer to output. Must have room for 2 bytes
+ *   Returns:
+ *     Number of bytes written, 0 to 2
+ */
+unsigned int base64_decoder_finish(base64_decoder *decoder, unsigned char output[]);
+
+/* Lookup tables for the table kernels (64 + 256 bytes). By default they live in RAM, which is the fastest
+ * option. Define BASE64_TABLES_IN_FLASH before including this file to keep them in flash (PROGMEM) on
+ * ESP8266/AVR instead, trading some speed for 320 bytes of RAM.
+ */
+#if defined(BASE64_TABLES_IN_FLASH) && (defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_AVR))
+  #if defined(ARDUINO_ARCH_AVR)
+    #include <avr/pgmspace.h>
+  #else
+    #include <pgmspace.h>
+  #endif
+  #define BASE64_TABLES_IN_PROGMEM 1
+  #define BASE64_TABLE_STORAGE PROGMEM
+  #define BASE64_TABLE_READ(table, i) pgm_read_byte(&(table)[i])
+#else
+  #define BASE64_TABLE_STORAGE
+  #define BASE64_TABLE_READ(table, i) ((table)[i])
+#endif
+
+// In C++ the tables are constexpr, so the fixed-size codec can read them in constant expressions
+#ifdef __cplusplus
+  #define BASE64_TABLE_CONST constexpr
+#else
+  #define BASE64_TABLE_CONST const
+#endif
+
+// Base64 alphabet, indexed by 6-bit value (trailing null terminator is unused)
+static BASE64_TABLE_CONST unsigned char base64_encode_table[65] BASE64_TABLE_STORAGE =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 6-bit value of each ascii code, 255 for characters outside the alphabet
+static BASE64_TABLE_CONST unsigned char base64_decode_table[256] BASE64_TABLE_STORAGE = {
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  62, 255, 255, 255,  63,
+   52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255, 255, 255, 255, 255,
+  255,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+   15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255, 255,
+  255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+   41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
 unsigned char binary_to_base64(unsigned char v) {
   // Capital letters - 'A' is ascii 65 and base64 0
   if(v < 26) return v + 'A';
@@ -112,6 +335,40 @@ unsigned int encode_base64_length(unsigned int input_length) {
 }
 
 unsigned int decode_base64_length(unsigned char input[]) {
+#ifdef BASE64_HAVE_X86_SIMD
+  switch(base64_simd_level()) {
+    case BASE64_SIMD_AVX2: return decode_base64_length_avx2(input);
+    case BASE64_SIMD_SSE41: return decode_base64_length_sse41(input);
+  }
+#endif
+  return decode_base64_length_table(input);
+}
+
+unsigned int encode_base64(unsigned char input[], unsigned int input_length, unsigned char output[]) {
+#ifdef BASE64_HAVE_X86_SIMD
+  switch(base64_simd_level()) {
+    case BASE64_SIMD_AVX2: return encode_base64_avx2(input, input_length, output);
+    case BASE64_SIMD_SSE41: return encode_base64_sse41(input, input_length, output);
+  }
+#endif
+#ifdef BASE64_PREFER_SWAR
+  return encode_base64_swar(input, input_length, output);
+#else
+  return encode_base64_table(input, input_length, output);
+#endif
+}
+
+unsigned int decode_base64(unsigned char input[], unsigned char output[]) {
+#ifdef BASE64_HAVE_X86_SIMD
+  switch(base64_simd_level()) {
+    case BASE64_SIMD_AVX2: return decode_base64_avx2(input, output);
+    case BASE64_SIMD_SSE41: return decode_base64_sse41(input, output);
+  }
+#endif
+  return decode_base64_table(input, output);
+}
+
+unsigned int decode_base64_length_branchy(unsigned char input[]) {
   unsigned char *start = input;
   
   while(base64_to_binary(input[0]) < 64) {
@@ -129,7 +386,7 @@ unsigned int decode_base64_length(unsigned char input[]) {
   }
 }
 
-unsigned int encode_base64(unsigned char input[], unsigned int input_length, unsigned char output[]) {
+unsigned int encode_base64_branchy(unsigned char input[], unsigned int input_length, unsigned char output[]) {
   unsigned int full_sets = input_length/3;
   
   // While there are still full sets of 24 bits...
@@ -166,8 +423,8 @@ unsigned int encode_base64(unsigned char input[], unsigned int input_length, uns
   return encode_base64_length(input_length);
 }
 
-unsigned int decode_base64(unsigned char input[], unsigned char output[]) {
-  unsigned int output_length = decode_base64_length(input);
+unsigned int decode_base64_branchy(unsigned char input[], unsigned char output[]) {
+  unsigned int output_length = decode_base64_length_branchy(input);
   
   // While there are still full sets of 24 bits...
   for(unsigned int i = 2; i < output_length; i += 3) {
@@ -192,4 +449,1107 @@ unsigned int decode_base64(unsigned char input[], unsigned char output[]) {
   return output_length;
 }
 
+unsigned int decode_base64_length_table(unsigned char input[]) {
+  unsigned char *start = input;
+  
+  while(BASE64_TABLE_READ(base64_decode_table, input[0]) < 64) {
+    ++input;
+  }
+  
+  unsigned int input_length = input - start;
+  
+  unsigned int output_length = input_length/4*3;
+  
+  switch(input_length % 4) {
+    default: return output_length;
+    case 2: return output_length + 1;
+    case 3: return output_length + 2;
+  }
+}
+
+unsigned int encode_base64_table(unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned int full_sets = input_length/3;
+  
+  // While there are still full sets of 24 bits...
+  for(unsigned int i = 0; i < full_sets; ++i) {
+    output[0] = BASE64_TABLE_READ(base64_encode_table,                          input[0] >> 2);
+    output[1] = BASE64_TABLE_READ(base64_encode_table, (input[0] & 0x03) << 4 | input[1] >> 4);
+    output[2] = BASE64_TABLE_READ(base64_encode_table, (input[1] & 0x0F) << 2 | input[2] >> 6);
+    output[3] = BASE64_TABLE_READ(base64_encode_table,  input[2] & 0x3F);
+    
+    input += 3;
+    output += 4;
+  }
+  
+  switch(input_length % 3) {
+    case 0:
+      output[0] = '\0';
+      break;
+    case 1:
+      output[0] = BASE64_TABLE_READ(base64_encode_table,                          input[0] >> 2);
+      output[1] = BASE64_TABLE_READ(base64_encode_table, (input[0] & 0x03) << 4);
+      output[2] = '=';
+      output[3] = '=';
+      output[4] = '\0';
+      break;
+    case 2:
+      output[0] = BASE64_TABLE_READ(base64_encode_table,                          input[0] >> 2);
+      output[1] = BASE64_TABLE_READ(base64_encode_table, (input[0] & 0x03) << 4 | input[1] >> 4);
+      output[2] = BASE64_TABLE_READ(base64_encode_table, (input[1] & 0x0F) << 2);
+      output[3] = '=';
+      output[4] = '\0';
+      break;
+  }
+  
+  return encode_base64_length(input_length);
+}
+
+unsigned int decode_base64_table(unsigned char input[], unsigned char output[]) {
+  unsigned int output_length = decode_base64_length_table(input);
+  
+  // While there are still full sets of 24 bits...
+  for(unsigned int i = 2; i < output_length; i += 3) {
+    unsigned char a = BASE64_TABLE_READ(base64_decode_table, input[0]);
+    unsigned char b = BASE64_TABLE_READ(base64_decode_table, input[1]);
+    unsigned char c = BASE64_TABLE_READ(base64_decode_table, input[2]);
+    unsigned char d = BASE64_TABLE_READ(base64_decode_table, input[3]);
+    
+    output[0] = a << 2 | b >> 4;
+    output[1] = b << 4 | c >> 2;
+    output[2] = c << 6 | d;
+    
+    input += 4;
+    output += 3;
+  }
+  
+  switch(output_length % 3) {
+    case 1:
+      output[0] = BASE64_TABLE_READ(base64_decode_table, input[0]) << 2 | BASE64_TABLE_READ(base64_decode_table, input[1]) >> 4;
+      break;
+    case 2:
+      output[0] = BASE64_TABLE_READ(base64_decode_table, input[0]) << 2 | BASE64_TABLE_READ(base64_decode_table, input[1]) >> 4;
+      output[1] = BASE64_TABLE_READ(base64_decode_table, input[1]) << 4 | BASE64_TABLE_READ(base64_decode_table, input[2]) >> 2;
+      break;
+  }
+  
+  return output_length;
+}
+
+// Spreads a 24-bit group into one 6-bit value per byte (first character in the low byte) and maps all four
+// to ascii at once. Each lane ends up as v + pos - neg, with pos and neg chosen so no lane carries or borrows
+static uint32_t base64_swar_encode_group(uint32_t group) {
+  uint32_t v = (group >> 18       ) | (group >> 12 & 0x3F) << 8 |
+               (group >>  6 & 0x3F) << 16 | (group & 0x3F) << 24;
+  
+  // High bit of each lane set when its value is >= 26, 52, 62, 63
+  uint32_t ge26 = ((v | 0x80808080) - 0x1A1A1A1A) & 0x80808080;
+  uint32_t ge52 = ((v | 0x80808080) - 0x34343434) & 0x80808080;
+  uint32_t ge62 = ((v | 0x80808080) - 0x3E3E3E3E) & 0x80808080;
+  uint32_t ge63 = ((v | 0x80808080) - 0x3F3F3F3F) & 0x80808080;
+  
+  // 'A' for 0-25, 'a' - 26 for 26-51, nothing above
+  uint32_t pos = (0x41414141 | ge26 >> 5 | ge26 >> 6) & ~((ge52 - (ge52 >> 7)) | ge52);
+  // 52 - '0' for 52-61, 62 - '+' for 62, 63 - '/' for 63
+  uint32_t neg = (ge52 >> 5) + ((ge62 >> 3) - (ge62 >> 7)) - (ge63 >> 6 | ge63 >> 7);
+  
+  return v + pos - neg;
+}
+
+unsigned int encode_base64_swar(unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned int full_sets = input_length/3;
+  uint32_t chars;
+  
+  // While there are still full sets of 24 bits...
+  for(unsigned int i = 0; i < full_sets; ++i) {
+    chars = base64_swar_encode_group((uint32_t) input[0] << 16 | (uint32_t) input[1] << 8 | input[2]);
+    
+    output[0] = chars;
+    output[1] = chars >> 8;
+    output[2] = chars >> 16;
+    output[3] = chars >> 24;
+    
+    input += 3;
+    output += 4;
+  }
+  
+  switch(input_length % 3) {
+    case 0:
+      output[0] = '\0';
+      break;
+    case 1:
+      chars = base64_swar_encode_group((uint32_t) input[0] << 16);
+      output[0] = chars;
+      output[1] = chars >> 8;
+      output[2] = '=';
+      output[3] = '=';
+      output[4] = '\0';
+      break;
+    case 2:
+      chars = base64_swar_encode_group((uint32_t) input[0] << 16 | (uint32_t) input[1] << 8);
+      output[0] = chars;
+      output[1] = chars >> 8;
+      output[2] = chars >> 16;
+      output[3] = '=';
+      output[4] = '\0';
+      break;
+  }
+  
+  return encode_base64_length(input_length);
+}
+
+unsigned int encode_base64_inplace(unsigned char buffer[], unsigned int input_length) {
+  unsigned int full_sets = input_length/3;
+  unsigned char *input = buffer + full_sets*3;
+  unsigned char *output = buffer + full_sets*4;
+  
+  // The partial set goes last in the output, after every byte of input
+  switch(input_length % 3) {
+    case 0:
+      output[0] = '\0';
+      break;
+    case 1: {
+      unsigned char first = input[0];
+      output[0] = BASE64_TABLE_READ(base64_encode_table,                      first >> 2);
+      output[1] = BASE64_TABLE_READ(base64_encode_table, (first & 0x03) << 4);
+      output[2] = '=';
+      output[3] = '=';
+      output[4] = '\0';
+      break;
+    }
+    case 2: {
+      unsigned char first = input[0], second = input[1];
+      output[0] = BASE64_TABLE_READ(base64_encode_table,                      first >> 2);
+      output[1] = BASE64_TABLE_READ(base64_encode_table, (first & 0x03) << 4 | second >> 4);
+      output[2] = BASE64_TABLE_READ(base64_encode_table, (second & 0x0F) << 2);
+      output[3] = '=';
+      output[4] = '\0';
+      break;
+    }
+  }
+  
+  // Full sets backwards: set i reads bytes 3i..3i+2 before writing characters 4i..4i+3, which only cover
+  // input of sets already encoded
+  while(input > buffer) {
+    input -= 3;
+    output -= 4;
+    
+    unsigned char a = input[0], b = input[1], c = input[2];
+    output[0] = BASE64_TABLE_READ(base64_encode_table,                  a >> 2);
+    output[1] = BASE64_TABLE_READ(base64_encode_table, (a & 0x03) << 4 | b >> 4);
+    output[2] = BASE64_TABLE_READ(base64_encode_table, (b & 0x0F) << 2 | c >> 6);
+    output[3] = BASE64_TABLE_READ(base64_encode_table,  c & 0x3F);
+  }
+  
+  return encode_base64_length(input_length);
+}
+
+unsigned int decode_base64_inplace(unsigned char buffer[]) {
+  return decode_base64(buffer, buffer);
+}
+
+void base64_encoder_init(base64_encoder *encoder) {
+  encoder->pending_length = 0;
+}
+
+unsigned int base64_encoder_update(base64_encoder *encoder, const unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned int written = 0;
+  
+  // Complete the group left over by the previous call
+  if(encoder->pending_length > 0) {
+    while(encoder->pending_length < 3 && input_length > 0) {
+      encoder->pending[encoder->pending_length++] = *input++;
+      --input_length;
+    }
+    
+    if(encoder->pending_length < 3) {
+      output[0] = '\0';
+      return 0;
+    }
+    
+    written = encode_base64(encoder->pending, 3, output);
+    encoder->pending_length = 0;
+  }
+  
+  unsigned int full_length = input_length/3*3;
+  written += encode_base64((unsigned char *) input, full_length, output + written);
+  
+  for(unsigned int i = full_length; i < input_length; ++i) {
+    encoder->pending[encoder->pending_length++] = input[i];
+  }
+  
+  return written;
+}
+
+unsigned int base64_encoder_finish(base64_encoder *encoder, unsigned char output[]) {
+  unsigned int written = encode_base64(encoder->pending, encoder->pending_length, output);
+  encoder->pending_length = 0;
+  
+  return written;
+}
+
+void base64_decoder_init(base64_decoder *decoder) {
+  decoder->pending_length = 0;
+  decoder->done = 0;
+}
+
+unsigned int base64_decoder_update(base64_decoder *decoder, const unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned char *start = output;
+  const unsigned char *end = input + input_length;
+  
+  while(!decoder->done && input < end) {
+    // Whole groups straight from the input while nothing is pending
+    if(decoder->pending_length == 0) {
+      for(; end - input >= 4; input += 4) {
+        unsigned char a = BASE64_TABLE_READ(base64_decode_table, input[0]);
+        unsigned char b = BASE64_TABLE_READ(base64_decode_table, input[1]);
+        unsigned char c = BASE64_TABLE_READ(base64_decode_table, input[2]);
+        unsigned char d = BASE64_TABLE_READ(base64_decode_table, input[3]);
+        
+        if((a | b | c | d) & 0x80) break;
+        
+        output[0] = a << 2 | b >> 4;
+        output[1] = b << 4 | c >> 2;
+        output[2] = c << 6 | d;
+        output += 3;
+      }
+      
+      if(input == end) break;
+    }
+    
+    unsigned char v = BASE64_TABLE_READ(base64_decode_table, *input++);
+    
+    if(v >= 64) {
+      decoder->done = 1;
+    } else if(decoder->pending_length < 3) {
+      decoder->pending[decoder->pending_length++] = v;
+    } else {
+      output[0] = decoder->pending[0] << 2 | decoder->pending[1] >> 4;
+      output[1] = decoder->pending[1] << 4 | decoder->pending[2] >> 2;
+      output[2] = decoder->pending[2] << 6 | v;
+      output += 3;
+      decoder->pending_length = 0;
+    }
+  }
+  
+  return output - start;
+}
+
+unsigned int base64_decoder_finish(base64_decoder *decoder, unsigned char output[]) {
+  unsigned int written = 0;
+  
+  if(decoder->pending_length >= 2) output[written++] = decoder->pending[0] << 2 | decoder->pending[1] >> 4;
+  if(decoder->pending_length >= 3) output[written++] = decoder->pending[1] << 4 | decoder->pending[2] >> 2;
+  
+  decoder->pending_length = 0;
+  decoder->done = 1;
+  
+  return written;
+}
+
+int base64_simd_level(void) {
+#ifdef BASE64_HAVE_X86_SIMD
+  static int level = -1;
+  
+  if(level < 0) {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) level = BASE64_SIMD_AVX2;
+    else if(__builtin_cpu_supports("sse4.1")) level = BASE64_SIMD_SSE41;
+    else level = BASE64_SIMD_NONE;
+  }
+  
+  return level;
+#else
+  return BASE64_SIMD_NONE;
+#endif
+}
+
+#ifdef BASE64_HAVE_X86_SIMD
+
+// Number of bytes encoded by a run of valid base64 characters
+static unsigned int base64_decoded_length(unsigned int chars) {
+  switch(chars % 4) {
+    default: return chars/4*3;
+    case 2: return chars/4*3 + 1;
+    case 3: return chars/4*3 + 2;
+  }
+}
+
+// Splits 12 bytes (in the low 12 lanes, per 128-bit lane for AVX2) into 16 6-bit values and maps them to ascii
+__attribute__((target("sse4.1")))
+static inline __m128i base64_encode_block_sse41(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  
+  __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+  __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+  __m128i indices = _mm_or_si128(t0, t1);
+  
+  // Pick an offset per range: 0-25 -> 13, 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, 63 -> 12
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+  
+  __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i base64_encode_block_avx2(__m256i in) {
+  in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                               10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  
+  __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+  __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+  __m256i indices = _mm256_or_si256(t0, t1);
+  
+  __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+  range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+  
+  __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                     '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                     'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                     '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  return _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+}
+
+// Classifies 16 characters. Lanes holding a base64 character are set to 0xFF in the result and their
+// 6-bit values are stored in *values
+__attribute__((target("sse4.1")))
+static inline __m128i base64_translate_sse41(__m128i c, __m128i *values) {
+  __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), c));
+  __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), c));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+  __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+  __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+  
+  __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+  shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+  shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+  shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+  shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+  *values = _mm_add_epi8(c, shift);
+  
+  return _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i base64_translate_avx2(__m256i c, __m256i *values) {
+  __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+  __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+  __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+  __m256i plus = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('+'));
+  __m256i slash = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/'));
+  
+  __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+  shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+  shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+  shift = _mm256_or_si256(shift, _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+  shift = _mm256_or_si256(shift, _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+  *values = _mm256_add_epi8(c, shift);
+  
+  return _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(plus, slash)));
+}
+
+// Packs 16 6-bit values into 12 bytes (in the low 12 lanes, per 128-bit lane for AVX2)
+__attribute__((target("sse4.1")))
+static inline __m128i base64_pack_sse41(__m128i values) {
+  __m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i base64_pack_avx2(__m256i values) {
+  __m256i merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+  merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  return _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+
+// Counts the leading base64 characters of a null-terminated string. Its length is found first, so vector
+// loads stay within the string and the last partial block is checked one character at a time
+__attribute__((target("sse4.1")))
+static unsigned int base64_valid_prefix_sse41(const unsigned char input[]) {
+  const unsigned char *p = input, *end = input + strlen((const char *) input);
+  
+  for(; end - p >= 16; p += 16) {
+    __m128i values;
+    unsigned int invalid = ~_mm_movemask_epi8(base64_translate_sse41(_mm_loadu_si128((const __m128i *) p), &values)) & 0xFFFF;
+    if(invalid) return p - input + __builtin_ctz(invalid);
+  }
+  
+  for(; p < end && BASE64_TABLE_READ(base64_decode_table, p[0]) < 64; ++p);
+  return p - input;
+}
+
+__attribute__((target("avx2")))
+static unsigned int base64_valid_prefix_avx2(const unsigned char input[]) {
+  const unsigned char *p = input, *end = input + strlen((const char *) input);
+  
+  for(; end - p >= 32; p += 32) {
+    __m256i values;
+    unsigned int invalid = ~(unsigned int) _mm256_movemask_epi8(base64_translate_avx2(_mm256_loadu_si256((const __m256i *) p), &values));
+    if(invalid) return p - input + __builtin_ctz(invalid);
+  }
+  
+  for(; p < end && BASE64_TABLE_READ(base64_decode_table, p[0]) < 64; ++p);
+  return p - input;
+}
+
+__attribute__((target("sse4.1")))
+unsigned int encode_base64_sse41(unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned int remaining = input_length;
+  
+  // Each block consumes 12 bytes but loads 16
+  for(; remaining >= 16; remaining -= 12) {
+    _mm_storeu_si128((__m128i *) output, base64_encode_block_sse41(_mm_loadu_si128((const __m128i *) input)));
+    
+    input += 12;
+    output += 16;
+  }
+  
+  encode_base64_table(input, remaining, output);
+  
+  return encode_base64_length(input_length);
+}
+
+__attribute__((target("avx2")))
+unsigned int encode_base64_avx2(unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned int remaining = input_length;
+  
+  // Each block consumes 24 bytes but loads 28
+  for(; remaining >= 28; remaining -= 24) {
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) input)),
+                                         _mm_loadu_si128((const __m128i *) (input + 12)), 1);
+    _mm256_storeu_si256((__m256i *) output, base64_encode_block_avx2(in));
+    
+    input += 24;
+    output += 32;
+  }
+  
+  // The tail runs legacy SSE code, which stalls on dirty upper halves of the ymm registers
+  _mm256_zeroupper();
+  encode_base64_sse41(input, remaining, output);
+  
+  return encode_base64_length(input_length);
+}
+
+__attribute__((target("sse4.1")))
+unsigned int decode_base64_length_sse41(unsigned char input[]) {
+  return base64_decoded_length(base64_valid_prefix_sse41(input));
+}
+
+__attribute__((target("avx2")))
+unsigned int decode_base64_length_avx2(unsigned char input[]) {
+  return base64_decoded_length(base64_valid_prefix_avx2(input));
+}
+
+__attribute__((target("sse4.1")))
+unsigned int decode_base64_sse41(unsigned char input[], unsigned char output[]) {
+  unsigned int chars = base64_valid_prefix_sse41(input);
+  unsigned int output_length = base64_decoded_length(chars);
+  
+  // Characters in the valid prefix need no further checks
+  for(; chars >= 16; chars -= 16) {
+    __m128i values;
+    base64_translate_sse41(_mm_loadu_si128((const __m128i *) input), &values);
+    __m128i packed = base64_pack_sse41(values);
+    
+    // Stores exactly 12 bytes, the output buffer may end right after them
+    _mm_storel_epi64((__m128i *) output, packed);
+    int last = _mm_extract_epi32(packed, 2);
+    memcpy(output + 8, &last, 4);
+    
+    input += 16;
+    output += 12;
+  }
+  
+  decode_base64_table(input, output);
+  
+  return output_length;
+}
+
+__attribute__((target("avx2")))
+unsigned int decode_base64_avx2(unsigned char input[], unsigned char output[]) {
+  unsigned int chars = base64_valid_prefix_avx2(input);
+  unsigned int output_length = base64_decoded_length(chars);
+  
+  for(; chars >= 32; chars -= 32) {
+    __m256i values;
+    base64_translate_avx2(_mm256_loadu_si256((const __m256i *) input), &values);
+    __m256i packed = base64_pack_avx2(values);
+    
+    // Stores exactly 24 bytes
+    _mm_storeu_si128((__m128i *) output, _mm256_castsi256_si128(packed));
+    _mm_storel_epi64((__m128i *) (output + 16), _mm256_extracti128_si256(packed, 1));
+    
+    input += 32;
+    output += 24;
+  }
+  
+  _mm256_zeroupper();
+  decode_base64_sse41(input, output);
+  
+  return output_length;
+}
+
+#endif // BASE64_HAVE_X86_SIMD
+
+#ifdef __cplusplus
+
+/* decode_base64_length (length-delimited):
+ *   Description:
+ *     Calculates in O(1) the number of bytes encoded by a base64 string of known length, which need not be
+ *     null-terminated. Up to two trailing '=' are treated as padding. Exact for well-formed input, an upper
+ *     bound otherwise
+ *   Parameters:
+ *     input - Pointer to base64 characters
+ *     input_length - Number of characters to read from input pointer
+ *   Returns:
+ *     Number of bytes of binary data in input
+ */
+size_t decode_base64_length(const unsigned char input[], size_t input_length);
+
+/* decode_base64 (length-delimited):
+ *   Description:
+ *     Converts input_length base64 characters to an array of bytes in a single pass, without needing a null
+ *     terminator, so it can decode slices of larger buffers in place. As with decode_base64(), the first
+ *     invalid character is interpreted as padding and ends decoding
+ *   Parameters:
+ *     input - Pointer to base64 characters
+ *     input_length - Number of characters to read from input pointer
+ *     output - Pointer to output array
+ *     output_capacity - Size of output array. Must be at least decode_base64_length(input, input_length)
+ *   Returns:
+ *     Number of bytes in the decoded binary, or 0 (with nothing written) if output_capacity is too small
+ */
+size_t decode_base64(const unsigned char input[], size_t input_length, unsigned char output[], size_t output_capacity);
+
+size_t decode_base64_length(const unsigned char input[], size_t input_length) {
+  if(input_length > 0 && input[input_length - 1] == '=') --input_length;
+  if(input_length > 0 && input[input_length - 1] == '=') --input_length;
+  
+  switch(input_length % 4) {
+    default: return input_length/4*3;
+    case 2: return input_length/4*3 + 1;
+    case 3: return input_length/4*3 + 2;
+  }
+}
+
+size_t decode_base64(const unsigned char input[], size_t input_length, unsigned char output[], size_t output_capacity) {
+  if(decode_base64_length(input, input_length) > output_capacity) return 0;
+  
+  const unsigned char *end = input + input_length;
+  unsigned char *start = output;
+  
+  // While there are still full sets of 24 bits...
+  for(; end - input >= 4; input += 4) {
+    unsigned char a = BASE64_TABLE_READ(base64_decode_table, input[0]);
+    unsigned char b = BASE64_TABLE_READ(base64_decode_table, input[1]);
+    unsigned char c = BASE64_TABLE_READ(base64_decode_table, input[2]);
+    unsigned char d = BASE64_TABLE_READ(base64_decode_table, input[3]);
+    
+    // Invalid characters have the high bit set, leave the group to the partial decode below
+    if((a | b | c | d) & 0x80) break;
+    
+    output[0] = a << 2 | b >> 4;
+    output[1] = b << 4 | c >> 2;
+    output[2] = c << 6 | d;
+    output += 3;
+  }
+  
+  // Last (or first invalid) group: decode its leading valid characters
+  unsigned char values[3];
+  size_t chars = 0;
+  for(; chars < 3 && input + chars < end; ++chars) {
+    values[chars] = BASE64_TABLE_READ(base64_decode_table, input[chars]);
+    if(values[chars] >= 64) break;
+  }
+  
+  if(chars >= 2) *output++ = values[0] << 2 | values[1] >> 4;
+  if(chars >= 3) *output++ = values[1] << 4 | values[2] >> 2;
+  
+  return output - start;
+}
+
+/* decode_base64_inplace (length-delimited):
+ *   Description:
+ *     Decodes a base64 slice into the start of the same slice, in a single pass. Each group is read before its
+ *     3 bytes are written, and those never reach characters not read yet
+ *   Parameters:
+ *     buffer - Base64 characters on entry, decoded bytes (from the start) on return
+ *     length - Number of characters in buffer
+ *   Returns:
+ *     Number of bytes in the decoded binary
+ */
+size_t decode_base64_inplace(unsigned char buffer[], size_t length);
+
+size_t decode_base64_inplace(unsigned char buffer[], size_t length) {
+  return decode_base64(buffer, length, buffer, length);
+}
+
+/* decode_base64_strict:
+ *   Description:
+ *     Strict variant of the length-delimited decode_base64(). Instead of treating invalid characters as
+ *     padding, the input is rejected unless it is canonical base64: a multiple of 4 characters, all from the
+ *     alphabet except for one or two trailing '=', and zero unused bits before the padding. Errors are ORed
+ *     together from the lookup table across the whole input and checked once at the end, so the per-character
+ *     path has no branches
+ *   Parameters:
+ *     input - Pointer to base64 characters
+ *     input_length - Number of characters to read from input pointer
+ *     output - Pointer to output array. Its contents are unspecified when the input is rejected
+ *     output_capacity - Size of output array
+ *   Returns:
+ *     Number of bytes in the decoded binary, or BASE64_INVALID if the input is malformed or does not fit
+ */
+static const size_t BASE64_INVALID = (size_t) -1;
+
+size_t decode_base64_strict(const unsigned char input[], size_t input_length, unsigned char output[], size_t output_capacity);
+
+size_t decode_base64_strict(const unsigned char input[], size_t input_length, unsigned char output[], size_t output_capacity) {
+  if(input_length % 4 != 0) return BASE64_INVALID;
+  if(input_length == 0) return 0;
+  
+  size_t padding = input[input_length - 1] != '=' ? 0 : input[input_length - 2] != '=' ? 1 : 2;
+  size_t output_length = input_length/4*3 - padding;
+  if(output_length > output_capacity) return BASE64_INVALID;
+  
+  const unsigned char *last = input + input_length - 4;
+  unsigned char error = 0;
+  
+  // Invalid characters map to 255, so bit 7 of error ends up set if any was seen
+  for(; input < last; input += 4) {
+    unsigned char a = BASE64_TABLE_READ(base64_decode_table, input[0]);
+    unsigned char b = BASE64_TABLE_READ(base64_decode_table, input[1]);
+    unsigned char c = BASE64_TABLE_READ(base64_decode_table, input[2]);
+    unsigned char d = BASE64_TABLE_READ(base64_decode_table, input[3]);
+    error |= a | b | c | d;
+    
+    output[0] = a << 2 | b >> 4;
+    output[1] = b << 4 | c >> 2;
+    output[2] = c << 6 | d;
+    output += 3;
+  }
+  
+  // Padding characters count as the value 0, but must leave no set bits behind
+  unsigned char a = BASE64_TABLE_READ(base64_decode_table, last[0]);
+  unsigned char b = BASE64_TABLE_READ(base64_decode_table, last[1]);
+  unsigned char c = padding >= 2 ? 0 : BASE64_TABLE_READ(base64_decode_table, last[2]);
+  unsigned char d = padding >= 1 ? 0 : BASE64_TABLE_READ(base64_decode_table, last[3]);
+  error |= a | b | c | d;
+  error |= (padding == 2 && (b & 0x0F)) << 7;
+  error |= (padding == 1 && (c & 0x03)) << 7;
+  
+  output[0] = a << 2 | b >> 4;
+  if(padding < 2) output[1] = b << 4 | c >> 2;
+  if(padding < 1) output[2] = c << 6 | d;
+  
+  return error & 0x80 ? BASE64_INVALID : output_length;
+}
+
+#if __cplusplus >= 201703L
+#if __has_include(<array>)
+#include <array>
+#define BASE64_HAVE_STD_ARRAY 1
+#endif
+
+// Asks GCC/Clang to fully unroll the fixed-size loops, they are not always unrolled at -O2/-Os
+#if defined(__GNUC__)
+  #define BASE64_UNROLL _Pragma("GCC unroll 32")
+#else
+  #define BASE64_UNROLL
+#endif
+
+// Branchless versions of binary_to_base64() and base64_to_binary() usable in constant expressions
+constexpr unsigned char base64_char(unsigned char v) {
+  return v + 'A' + (v >= 26)*6 - (v >= 52)*75 - (v >= 62)*15 + (v >= 63)*3;
+}
+
+constexpr unsigned char base64_value(unsigned char c) {
+  bool upper = (unsigned char) (c - 'A') < 26;
+  bool lower = (unsigned char) (c - 'a') < 26;
+  bool digit = (unsigned char) (c - '0') < 10;
+  bool plus = c == '+';
+  bool slash = c == '/';
+  
+  return upper*(c - 'A') + lower*(c - 'a' + 26) + digit*(c - '0' + 52) + plus*62 + slash*63 +
+         !(upper | lower | digit | plus | slash)*255;
+}
+
+// Character mapping for the fixed-size codec: the lookup tables when they are in RAM, arithmetic when they are
+// in flash (pgm_read_byte() is not constexpr)
+constexpr unsigned char base64_fixed_char(unsigned char v) {
+#ifdef BASE64_TABLES_IN_PROGMEM
+  return base64_char(v);
+#else
+  return base64_encode_table[v];
+#endif
+}
+
+constexpr unsigned char base64_fixed_value(unsigned char c) {
+#ifdef BASE64_TABLES_IN_PROGMEM
+  return base64_value(c);
+#else
+  return base64_decode_table[c];
+#endif
+}
+
+/* Alphabet and padding policies:
+ *   Description:
+ *     base64_codec<Policy> is specialized at compile time for an alphabet (the characters for 62 and 63) and
+ *     for whether '=' padding is written and expected. Each policy compiles to its own code and tables, there
+ *     are no runtime checks of the variant
+ *       base64_standard          - '+', '/', padded (RFC 4648 section 4, same as encode_base64())
+ *       base64_standard_unpadded - '+', '/', no padding
+ *       base64_url               - '-', '_', padded (RFC 4648 section 5)
+ *       base64_url_unpadded      - '-', '_', no padding
+ */
+template <unsigned char Char62, unsigned char Char63>
+struct base64_alphabet {
+  struct tables_type {
+    unsigned char encode[64];
+    unsigned char decode[256];
+  };
+  
+  static constexpr tables_type make_tables() {
+    tables_type tables{};
+    for(unsigned int v = 0; v < 64; ++v) tables.encode[v] = v < 62 ? base64_char(v) : v == 62 ? Char62 : Char63;
+    for(unsigned int c = 0; c < 256; ++c) tables.decode[c] = 255;
+    for(unsigned int v = 0; v < 64; ++v) tables.decode[tables.encode[v]] = v;
+    return tables;
+  }
+  
+  static constexpr tables_type tables = make_tables();
+  
+  static constexpr unsigned char character(unsigned char v) { return tables.encode[v]; }
+  static constexpr unsigned char value(unsigned char c) { return tables.decode[c]; }
+};
+
+// The standard alphabet shares the tables of the C API
+template <>
+struct base64_alphabet<'+', '/'> {
+  static constexpr unsigned char character(unsigned char v) { return base64_fixed_char(v); }
+  static constexpr unsigned char value(unsigned char c) { return base64_fixed_value(c); }
+};
+
+template <typename Alphabet, bool Padding>
+struct base64_policy : Alphabet {
+  static constexpr bool padding = Padding;
+};
+
+typedef base64_policy<base64_alphabet<'+', '/'>, true> base64_standard;
+typedef base64_policy<base64_alphabet<'+', '/'>, false> base64_standard_unpadded;
+typedef base64_policy<base64_alphabet<'-', '_'>, true> base64_url;
+typedef base64_policy<base64_alphabet<'-', '_'>, false> base64_url_unpadded;
+
+/* base64_codec<Policy>:
+ *   Description:
+ *     Encoder and decoder for one policy. The runtime functions mirror the length-delimited C++ API:
+ *       encoded_length(n)                       - characters needed for n bytes
+ *       decoded_length(in, n)                   - O(1) byte count of n characters (trailing '=' stripped)
+ *       encode(in, n, out)                      - writes encoded_length(n) characters and a null terminator
+ *       decode(in, n, out, cap)                 - first invalid character ends decoding, as decode_base64()
+ *       decode_strict(in, n, out, cap)          - canonical input only, as decode_base64_strict(). Padded
+ *                                                 policies require the padding, unpadded ones reject it
+ *     and the fixed-size ones mirror encode_base64<N>(), decode_base64<N>() and decode_base64_strict<N>():
+ *       encode<N>(in, out), decode<N>(in, out), decode_strict<N>(in, out)
+ *     Everything is constexpr. Requires C++17
+ */
+template <typename Policy>
+struct base64_codec {
+  static constexpr size_t encoded_length(size_t n) {
+    return Policy::padding ? (n + 2)/3*4 : n/3*4 + (n % 3 ? n % 3 + 1 : 0);
+  }
+  
+  static constexpr size_t decoded_length(const unsigned char input[], size_t n) {
+    if(n > 0 && input[n - 1] == '=') --n;
+    if(n > 0 && input[n - 1] == '=') --n;
+    
+    return n/4*3 + (n % 4 > 1 ? n % 4 - 1 : 0);
+  }
+  
+  static constexpr size_t encode(const unsigned char input[], size_t n, unsigned char output[]) {
+    size_t length = encoded_length(n);
+    
+    for(; n >= 3; n -= 3) {
+      output[0] = Policy::character(input[0] >> 2);
+      output[1] = Policy::character((input[0] & 0x03) << 4 | input[1] >> 4);
+      output[2] = Policy::character((input[1] & 0x0F) << 2 | input[2] >> 6);
+      output[3] = Policy::character(input[2] & 0x3F);
+      
+      input += 3;
+      output += 4;
+    }
+    
+    if(n > 0) {
+      unsigned char second = n > 1 ? input[1] : 0;
+      *output++ = Policy::character(input[0] >> 2);
+      *output++ = Policy::character((input[0] & 0x03) << 4 | second >> 4);
+      if(n > 1) *output++ = Policy::character((second & 0x0F) << 2);
+      else if(Policy::padding) *output++ = '=';
+      if(Policy::padding) *output++ = '=';
+    }
+    
+    output[0] = '\0';
+    
+    return length;
+  }
+  
+  static constexpr size_t decode(const unsigned char input[], size_t n, unsigned char output[], size_t output_capacity) {
+    if(decoded_length(input, n) > output_capacity) return 0;
+    
+    const unsigned char *end = input + n;
+    size_t written = 0;
+    
+    for(; end - input >= 4; input += 4) {
+      unsigned char a = Policy::value(input[0]);
+      unsigned char b = Policy::value(input[1]);
+      unsigned char c = Policy::value(input[2]);
+      unsigned char d = Policy::value(input[3]);
+      
+      if((a | b | c | d) & 0x80) break;
+      
+      output[written++] = a << 2 | b >> 4;
+      output[written++] = b << 4 | c >> 2;
+      output[written++] = c << 6 | d;
+    }
+    
+    // Last (or first invalid) group: decode its leading valid characters
+    unsigned char values[3] = {0, 0, 0};
+    size_t chars = 0;
+    for(; chars < 3 && input + chars < end; ++chars) {
+      values[chars] = Policy::value(input[chars]);
+      if(values[chars] >= 64) break;
+    }
+    
+    if(chars >= 2) output[written++] = values[0] << 2 | values[1] >> 4;
+    if(chars >= 3) output[written++] = values[1] << 4 | values[2] >> 2;
+    
+    return written;
+  }
+  
+  static constexpr size_t decode_strict(const unsigned char input[], size_t n, unsigned char output[], size_t output_capacity) {
+    size_t padding = 0;
+    
+    if(Policy::padding) {
+      if(n % 4 != 0) return BASE64_INVALID;
+      if(n > 0) padding = input[n - 1] != '=' ? 0 : input[n - 2] != '=' ? 1 : 2;
+    } else if(n % 4 == 1) {
+      return BASE64_INVALID;
+    }
+    
+    // Characters carrying data, the last group may be partial
+    size_t chars = n - padding;
+    size_t output_length = chars/4*3 + (chars % 4 ? chars % 4 - 1 : 0);
+    if(output_length > output_capacity) return BASE64_INVALID;
+    
+    const unsigned char *last = input + chars/4*4;
+    unsigned char error = 0;
+    
+    for(; input < last; input += 4) {
+      unsigned char a = Policy::value(input[0]);
+      unsigned char b = Policy::value(input[1]);
+      unsigned char c = Policy::value(input[2]);
+      unsigned char d = Policy::value(input[3]);
+      error |= a | b | c | d;
+      
+      output[0] = a << 2 | b >> 4;
+      output[1] = b << 4 | c >> 2;
+      output[2] = c << 6 | d;
+      output += 3;
+    }
+    
+    // Partial group: the bits below the last byte must be zero
+    if(chars % 4 >= 2) {
+      unsigned char a = Policy::value(last[0]);
+      unsigned char b = Policy::value(last[1]);
+      unsigned char c = chars % 4 == 3 ? Policy::value(last[2]) : 0;
+      error |= a | b | c;
+      error |= (chars % 4 == 2 && (b & 0x0F)) << 7;
+      error |= (chars % 4 == 3 && (c & 0x03)) << 7;
+      
+      output[0] = a << 2 | b >> 4;
+      if(chars % 4 == 3) output[1] = b << 4 | c >> 2;
+    }
+    
+    return error & 0x80 ? BASE64_INVALID : output_length;
+  }
+  
+  template <size_t N>
+  static constexpr void encode(const unsigned char input[], unsigned char output[]) {
+    BASE64_UNROLL
+    for(size_t i = 0; i < N; i += 3) {
+      uint32_t group = (uint32_t) input[i] << 16 |
+                       (i + 1 < N ? (uint32_t) input[i + 1] << 8 : 0) |
+                       (i + 2 < N ? (uint32_t) input[i + 2] : 0);
+      
+      output[0] = Policy::character(group >> 18);
+      output[1] = Policy::character(group >> 12 & 0x3F);
+      if(i + 1 < N) output[2] = Policy::character(group >> 6 & 0x3F);
+      else if(Policy::padding) output[2] = '=';
+      if(i + 2 < N) output[3] = Policy::character(group & 0x3F);
+      else if(Policy::padding) output[3] = '=';
+      output += 4;
+    }
+  }
+  
+  template <size_t N, typename Char>
+  static constexpr size_t decode(const Char input[], unsigned char output[]) {
+    size_t decoded = 0;
+    unsigned char valid = 1;
+    
+    // valid drops to 0 at the first invalid character and masks every byte after it
+    BASE64_UNROLL
+    for(size_t i = 0; i < N; i += 3) {
+      unsigned char a = Policy::value((unsigned char) input[0]);
+      unsigned char b = Policy::value((unsigned char) input[1]);
+      unsigned char c = i + 1 < N ? Policy::value((unsigned char) input[2]) : 0;
+      unsigned char d = i + 2 < N ? Policy::value((unsigned char) input[3]) : 0;
+      
+      valid &= ~(a | b) >> 7;
+      output[i] = (unsigned char) (a << 2 | b >> 4) & (unsigned char) -valid;
+      decoded += valid;
+      
+      if(i + 1 < N) {
+        valid &= ~c >> 7;
+        output[i + 1] = (unsigned char) (b << 4 | c >> 2) & (unsigned char) -valid;
+        decoded += valid;
+      }
+      
+      if(i + 2 < N) {
+        valid &= ~d >> 7;
+        output[i + 2] = (unsigned char) (c << 6 | d) & (unsigned char) -valid;
+        decoded += valid;
+      }
+      
+      input += 4;
+    }
+    
+    return decoded;
+  }
+  
+  template <size_t N, typename Char>
+  static constexpr bool decode_strict(const Char input[], unsigned char output[]) {
+    unsigned char error = 0;
+    
+    BASE64_UNROLL
+    for(size_t i = 0; i < N; i += 3) {
+      unsigned char a = Policy::value((unsigned char) input[0]);
+      unsigned char b = Policy::value((unsigned char) input[1]);
+      unsigned char c = i + 1 < N ? Policy::value((unsigned char) input[2]) : 0;
+      unsigned char d = i + 2 < N ? Policy::value((unsigned char) input[3]) : 0;
+      error |= a | b | c | d;
+      
+      // Trailing group: the padding characters and the unused bits they leave
+      if(i + 1 >= N) error |= ((Policy::padding && (input[2] != '=' || input[3] != '=')) || (b & 0x0F) != 0) << 7;
+      else if(i + 2 >= N) error |= ((Policy::padding && input[3] != '=') || (c & 0x03) != 0) << 7;
+      
+      output[i] = a << 2 | b >> 4;
+      if(i + 1 < N) output[i + 1] = b << 4 | c >> 2;
+      if(i + 2 < N) output[i + 2] = c << 6 | d;
+      
+      input += 4;
+    }
+    
+    return !(error & 0x80);
+  }
+};
+
+/* Fixed-size codec:
+ *   Description:
+ *     encode_base64<N>() and decode_base64<N>() for a binary length N known at compile time, such as a
+ *     signature tag. The loops have a constant trip count, so the compiler unrolls them, and they are
+ *     constexpr, so they also run at compile time (for example to embed pre-encoded constants). Output is
+ *     identical to encode_base64()/decode_base64(). An alphabet/padding policy may be given as second
+ *     template argument, base64_standard by default. Requires C++17
+ */
+
+// Number of base64 characters (including any padding) encoding N bytes
+template <size_t N, typename Policy = base64_standard>
+constexpr size_t base64_encoded_size = base64_codec<Policy>::encoded_length(N);
+
+/* encode_base64<N>:
+ *   Description:
+ *     Converts N bytes to base64_encoded_size<N> characters (no null terminator)
+ *   Parameters:
+ *     input - Pointer to N bytes of input data
+ *     output - Pointer to output, base64_encoded_size<N> characters are written
+ */
+template <size_t N, typename Policy = base64_standard>
+constexpr void encode_base64(const unsigned char input[], unsigned char output[]) {
+  base64_codec<Policy>::template encode<N>(input, output);
+}
+
+/* decode_base64<N>:
+ *   Description:
+ *     Converts base64_encoded_size<N> characters back to N bytes. As with decode_base64(), the first invalid
+ *     character ends decoding. Bytes that are not decoded are set to 0 (branch-free)
+ *   Parameters:
+ *     input - Pointer to base64_encoded_size<N> characters (char or unsigned char)
+ *     output - Pointer to output, N bytes are written
+ *   Returns:
+ *     Number of bytes decoded before the first invalid character, N for well-formed input
+ */
+template <size_t N, typename Policy = base64_standard, typename Char>
+constexpr size_t decode_base64(const Char input[], unsigned char output[]) {
+  return base64_codec<Policy>::template decode<N>(input, output);
+}
+
+/* decode_base64_strict<N>:
+ *   Description:
+ *     Strict variant of decode_base64<N>(): the input must be exactly the canonical encoding of N bytes
+ *     (alphabet characters, the expected '=' padding, zero unused bits). Errors are accumulated without
+ *     branches and checked once at the end
+ *   Parameters:
+ *     input - Pointer to base64_encoded_size<N> characters (char or unsigned char)
+ *     output - Pointer to output, N bytes are written. Contents are unspecified when the input is rejected
+ *   Returns:
+ *     true if the input was valid
+ */
+template <size_t N, typename Policy = base64_standard, typename Char>
+constexpr bool decode_base64_strict(const Char input[], unsigned char output[]) {
+  return base64_codec<Policy>::template decode_strict<N>(input, output);
+}
+
+#ifdef BASE64_HAVE_STD_ARRAY
+/* encode_base64(array), decode_base64<N>(array):
+ *   Description:
+ *     Value-returning forms of the fixed-size codec for std::array and C arrays, usable in constexpr
+ *     initializers. decode_base64<N>() takes the encoded characters, as from a string literal (any trailing
+ *     null terminator is ignored)
+ */
+template <typename Policy = base64_standard, size_t N>
+constexpr std::array<unsigned char, base64_encoded_size<N, Policy>> encode_base64(const std::array<unsigned char, N> &input) {
+  std::array<unsigned char, base64_encoded_size<N, Policy>> output{};
+  encode_base64<N, Policy>(input.data(), output.data());
+  return output;
+}
+
+template <typename Policy = base64_standard, size_t N>
+constexpr std::array<unsigned char, base64_encoded_size<N, Policy>> encode_base64(const unsigned char (&input)[N]) {
+  std::array<unsigned char, base64_encoded_size<N, Policy>> output{};
+  encode_base64<N, Policy>(input, output.data());
+  return output;
+}
+
+template <size_t N, typename Policy = base64_standard, typename Char, size_t M>
+constexpr std::array<unsigned char, N> decode_base64(const std::array<Char, M> &input) {
+  static_assert(M >= base64_encoded_size<N, Policy>, "input shorter than the encoding of N bytes");
+  std::array<unsigned char, N> output{};
+  decode_base64<N, Policy>(input.data(), output.data());
+  return output;
+}
+
+template <size_t N, typename Policy = base64_standard, typename Char, size_t M>
+constexpr std::array<unsigned char, N> decode_base64(const Char (&input)[M]) {
+  static_assert(M >= base64_encoded_size<N, Policy>, "input shorter than the encoding of N bytes");
+  std::array<unsigned char, N> output{};
+  decode_base64<N, Policy>(input, output.data());
+  return output;
+}
+#endif // BASE64_HAVE_STD_ARRAY
+
+#endif // __cplusplus >= 201703L
+
+#endif // __cplusplus
+
 #endif // ifndef
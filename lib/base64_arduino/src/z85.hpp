@@ -0,0 +1,469 @@
+/**
+ * Z85 (ZeroMQ RFC 32) encoding and decoding of strings. Packs each 4 bytes, read as a big-endian 32-bit
+ * number, into 5 base-85 digits, so the binary length must be a multiple of 4 and there is no padding
+ */
+
+#ifndef Z85_H_INCLUDED
+#define Z85_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* encode_z85_length:
+ *   Description:
+ *     Calculates length of Z85 string needed for a given number of binary bytes
+ *   Parameters:
+ *     input_length - Amount of binary data in bytes, a multiple of 4
+ *   Returns:
+ *     Number of Z85 characters needed to encode input_length bytes of binary data
+ */
+unsigned int encode_z85_length(unsigned int input_length);
+
+/* decode_z85_length:
+ *   Description:
+ *     Calculates number of bytes decode_z85() gets from a Z85 string
+ *   Parameters:
+ *     input - Z85-encoded null-terminated string
+ *   Returns:
+ *     Number of bytes of binary data in the leading complete, valid groups of input
+ */
+unsigned int decode_z85_length(unsigned char input[]);
+
+/* encode_z85:
+ *   Description:
+ *     Converts an array of bytes to a Z85 null-terminated string
+ *   Parameters:
+ *     input - Pointer to input data
+ *     input_length - Number of bytes to read from input pointer, a multiple of 4
+ *     output - Pointer to output string. Null terminator will be added automatically
+ *   Returns:
+ *     Length of encoded string in bytes (not including null terminator), 0 (with only the null terminator
+ *     written) if input_length is not a multiple of 4
+ */
+unsigned int encode_z85(unsigned char input[], unsigned int input_length, unsigned char output[]);
+
+/* decode_z85:
+ *   Description:
+ *     Converts a Z85 null-terminated string to an array of bytes. Decoding ends at the first group that has a
+ *     character outside the alphabet (such as the null terminator) or a value above 32 bits, an incomplete
+ *     trailing group is ignored
+ *   Parameters:
+ *     input - Pointer to input string
+ *     output - Pointer to output array
+ *   Returns:
+ *     Number of bytes in the decoded binary
+ */
+unsigned int decode_z85(unsigned char input[], unsigned char output[]);
+
+/* z85_encoder, z85_decoder:
+ *   Description:
+ *     State of a streaming encode or decode, as base64_encoder/base64_decoder. Input may be fed in chunks of
+ *     any size, the partial 4-byte (or 5-character) group is carried across calls. Concatenating the outputs
+ *     of every update gives the same result as encode_z85() or decode_z85() on the whole input
+ */
+typedef struct {
+  unsigned char pending[3];
+  unsigned char pending_length;
+} z85_encoder;
+
+typedef struct {
+  unsigned char pending[4];
+  unsigned char pending_length;
+  unsigned char error; // Set once an invalid group has been seen, the rest is ignored
+} z85_decoder;
+
+/* z85_encoder_init, z85_decoder_init:
+ *   Description:
+ *     Resets the state to start a new encode or decode
+ */
+void z85_encoder_init(z85_encoder *encoder);
+void z85_decoder_init(z85_decoder *decoder);
+
+/* z85_encoder_update:
+ *   Description:
+ *     Encodes a chunk of binary data. Complete groups are written out, up to 3 trailing bytes are kept for the
+ *     next call
+ *   Parameters:
+ *     encoder - Encoder state
+ *     input - Pointer to input data
+ *     input_length - Number of bytes to read from input pointer
+ *     output - Pointer to output. Must have room for (input_length + 3)/4*5 + 1 bytes (a null terminator is
+ *              added after the characters written)
+ *   Returns:
+ *     Number of Z85 characters written (not including null terminator)
+ */
+unsigned int z85_encoder_update(z85_encoder *encoder, const unsigned char input[], unsigned int input_length, unsigned char output[]);
+
+/* z85_encoder_finish:
+ *   Description:
+ *     Ends the encode. The encoder must be reset before reuse
+ *   Parameters:
+ *     encoder - Encoder state
+ *   Returns:
+ *     1 if the total input length was a multiple of 4, 0 if 1 to 3 trailing bytes were left unencoded
+ */
+int z85_encoder_finish(z85_encoder *encoder);
+
+/* z85_decoder_update:
+ *   Description:
+ *     Decodes a chunk of Z85 characters. Complete groups are written out, up to 4 trailing characters are kept
+ *     for the next call. After the first invalid group all further input is ignored
+ *   Parameters:
+ *     decoder - Decoder state
+ *     input - Pointer to input characters
+ *     input_length - Number of characters to read from input pointer
+ *     output - Pointer to output. Must have room for (input_length + 4)/5*4 bytes
+ *   Returns:
+ *     Number of bytes written
+ */
+unsigned int z85_decoder_update(z85_decoder *decoder, const unsigned char input[], unsigned int input_length, unsigned char output[]);
+
+/* z85_decoder_finish:
+ *   Description:
+ *     Ends the decode. The decoder must be reset before reuse
+ *   Parameters:
+ *     decoder - Decoder state
+ *   Returns:
+ *     1 if the whole input was valid Z85 (only complete groups, all in range), 0 otherwise
+ */
+int z85_decoder_finish(z85_decoder *decoder);
+
+// In C++ the tables are constexpr, so the fixed-size codec can read them in constant expressions
+#ifdef __cplusplus
+  #define Z85_TABLE_CONST constexpr
+#else
+  #define Z85_TABLE_CONST const
+#endif
+
+// Z85 alphabet, indexed by digit value (trailing null terminator is unused)
+static Z85_TABLE_CONST unsigned char z85_encode_table[86] =
+  "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.-:+=^!/*?&<>()[]{}@%$#";
+
+// Digit value of each ascii code, 255 for characters outside the alphabet
+static Z85_TABLE_CONST unsigned char z85_decode_table[256] = {
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255,  68, 255,  84,  83,  82,  72, 255,  75,  76,  70,  65, 255,  63,  62,  69,
+    0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  64, 255,  73,  66,  74,  71,
+   81,  36,  37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,
+   51,  52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  77, 255,  78,  67, 255,
+  255,  10,  11,  12,  13,  14,  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,
+   25,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  79, 255,  80, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
+// Writes the 5 digits of a big-endian 32-bit group
+static void z85_encode_group(const unsigned char input[], unsigned char output[]) {
+  uint32_t value = (uint32_t) input[0] << 24 | (uint32_t) input[1] << 16 | (uint32_t) input[2] << 8 | input[3];
+  
+  output[4] = z85_encode_table[value % 85]; value /= 85;
+  output[3] = z85_encode_table[value % 85]; value /= 85;
+  output[2] = z85_encode_table[value % 85]; value /= 85;
+  output[1] = z85_encode_table[value % 85]; value /= 85;
+  output[0] = z85_encode_table[value];
+}
+
+// Decodes a group of 5 characters to 4 bytes. Returns 0 (output unspecified) if a character is outside the
+// alphabet or the value does not fit in 32 bits
+static int z85_decode_group(const unsigned char input[], unsigned char output[]) {
+  unsigned char a = z85_decode_table[input[0]];
+  unsigned char b = z85_decode_table[input[1]];
+  unsigned char c = z85_decode_table[input[2]];
+  unsigned char d = z85_decode_table[input[3]];
+  unsigned char e = z85_decode_table[input[4]];
+  
+  uint64_t value = (uint64_t) (((a*85u + b)*85u + c)*85u + d)*85u + e;
+  
+  output[0] = value >> 24;
+  output[1] = value >> 16;
+  output[2] = value >> 8;
+  output[3] = value;
+  
+  // Digits are below 128, so bit 7 is only set by characters outside the alphabet
+  return !((a | b | c | d | e) & 0x80) && value <= 0xFFFFFFFF;
+}
+
+unsigned int encode_z85_length(unsigned int input_length) {
+  return input_length/4*5;
+}
+
+// Decodes the next group of a null-terminated string into group. Characters are checked in order, so nothing
+// past the null terminator is read. Returns 0 at the end of the valid groups
+static int z85_next_group(const unsigned char input[], unsigned char group[]) {
+  for(unsigned int i = 0; i < 5; ++i) {
+    if(z85_decode_table[input[i]] >= 85) return 0;
+  }
+  
+  return z85_decode_group(input, group);
+}
+
+unsigned int decode_z85_length(unsigned char input[]) {
+  unsigned char group[4];
+  unsigned int output_length = 0;
+  
+  for(; z85_next_group(input, group); input += 5) output_length += 4;
+  
+  return output_length;
+}
+
+unsigned int encode_z85(unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  if(input_length % 4 != 0) {
+    output[0] = '\0';
+    return 0;
+  }
+  
+  for(unsigned int i = 0; i < input_length; i += 4) {
+    z85_encode_group(input + i, output);
+    output += 5;
+  }
+  
+  output[0] = '\0';
+  
+  return encode_z85_length(input_length);
+}
+
+unsigned int decode_z85(unsigned char input[], unsigned char output[]) {
+  unsigned char *start = output;
+  unsigned char group[4];
+  
+  for(; z85_next_group(input, group); input += 5) {
+    output[0] = group[0];
+    output[1] = group[1];
+    output[2] = group[2];
+    output[3] = group[3];
+    output += 4;
+  }
+  
+  return output - start;
+}
+
+void z85_encoder_init(z85_encoder *encoder) {
+  encoder->pending_length = 0;
+}
+
+unsigned int z85_encoder_update(z85_encoder *encoder, const unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned char *start = output;
+  const unsigned char *end = input + input_length;
+  
+  // Complete the pending group first
+  if(encoder->pending_length > 0) {
+    unsigned char group[4];
+    unsigned int pending = encoder->pending_length;
+    
+    for(unsigned int i = 0; i < pending; ++i) group[i] = encoder->pending[i];
+    for(; pending < 4 && input < end; ++pending) group[pending] = *input++;
+    
+    if(pending < 4) {
+      for(unsigned int i = encoder->pending_length; i < pending; ++i) encoder->pending[i] = group[i];
+      encoder->pending_length = pending;
+      output[0] = '\0';
+      return 0;
+    }
+    
+    z85_encode_group(group, output);
+    output += 5;
+    encoder->pending_length = 0;
+  }
+  
+  for(; end - input >= 4; input += 4) {
+    z85_encode_group(input, output);
+    output += 5;
+  }
+  
+  while(input < end) encoder->pending[encoder->pending_length++] = *input++;
+  
+  output[0] = '\0';
+  
+  return output - start;
+}
+
+int z85_encoder_finish(z85_encoder *encoder) {
+  int complete = encoder->pending_length == 0;
+  encoder->pending_length = 0;
+  return complete;
+}
+
+void z85_decoder_init(z85_decoder *decoder) {
+  decoder->pending_length = 0;
+  decoder->error = 0;
+}
+
+unsigned int z85_decoder_update(z85_decoder *decoder, const unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned char *start = output;
+  const unsigned char *end = input + input_length;
+  
+  if(decoder->error) return 0;
+  
+  // Complete the pending group first
+  if(decoder->pending_length > 0) {
+    unsigned char group[5];
+    unsigned int pending = decoder->pending_length;
+    
+    for(unsigned int i = 0; i < pending; ++i) group[i] = decoder->pending[i];
+    for(; pending < 5 && input < end; ++pending) group[pending] = *input++;
+    
+    if(pending < 5) {
+      for(unsigned int i = decoder->pending_length; i < pending; ++i) decoder->pending[i] = group[i];
+      decoder->pending_length = pending;
+      return 0;
+    }
+    
+    decoder->pending_length = 0;
+    if(!z85_decode_group(group, output)) {
+      decoder->error = 1;
+      return 0;
+    }
+    output += 4;
+  }
+  
+  for(; end - input >= 5; input += 5) {
+    if(!z85_decode_group(input, output)) {
+      decoder->error = 1;
+      return output - start;
+    }
+    output += 4;
+  }
+  
+  while(input < end) decoder->pending[decoder->pending_length++] = *input++;
+  
+  return output - start;
+}
+
+int z85_decoder_finish(z85_decoder *decoder) {
+  int valid = !decoder->error && decoder->pending_length == 0;
+  decoder->pending_length = 0;
+  decoder->error = 1;
+  return valid;
+}
+
+#ifdef __cplusplus
+
+/* decode_z85 (length-delimited):
+ *   Description:
+ *     Converts input_length Z85 characters to an array of bytes, without needing a null terminator. Z85 has
+ *     no padding, so every input is either exactly valid or rejected: input_length must be a multiple of 5,
+ *     with every character in the alphabet and every group within 32 bits. Errors are ORed together across
+ *     the whole input and checked once at the end, as in decode_base64_strict()
+ *   Parameters:
+ *     input - Pointer to Z85 characters
+ *     input_length - Number of characters to read from input pointer
+ *     output - Pointer to output array. Its contents are unspecified when the input is rejected
+ *     output_capacity - Size of output array
+ *   Returns:
+ *     Number of bytes in the decoded binary, or Z85_INVALID if the input is malformed or does not fit
+ */
+static const size_t Z85_INVALID = (size_t) -1;
+
+size_t decode_z85(const unsigned char input[], size_t input_length, unsigned char output[], size_t output_capacity);
+
+size_t decode_z85(const unsigned char input[], size_t input_length, unsigned char output[], size_t output_capacity) {
+  if(input_length % 5 != 0) return Z85_INVALID;
+  
+  size_t output_length = input_length/5*4;
+  if(output_length > output_capacity) return Z85_INVALID;
+  
+  int valid = 1;
+  
+  for(size_t i = 0; i < input_length; i += 5) {
+    valid &= z85_decode_group(input + i, output);
+    output += 4;
+  }
+  
+  return valid ? output_length : Z85_INVALID;
+}
+
+#if __cplusplus >= 201703L
+
+#if defined(__GNUC__)
+  #define Z85_UNROLL _Pragma("GCC unroll 16")
+#else
+  #define Z85_UNROLL
+#endif
+
+/* Fixed-size codec:
+ *   Description:
+ *     encode_z85<N>() and decode_z85<N>() for a binary length N (a multiple of 4) known at compile time, such
+ *     as a signature tag. As with encode_base64<N>(), the loops have a constant trip count and are constexpr.
+ *     Requires C++17
+ */
+
+// Number of Z85 characters encoding N bytes
+template <size_t N>
+constexpr size_t z85_encoded_size = N/4*5;
+
+/* encode_z85<N>:
+ *   Description:
+ *     Converts N bytes to z85_encoded_size<N> characters (no null terminator)
+ *   Parameters:
+ *     input - Pointer to N bytes of input data
+ *     output - Pointer to output, z85_encoded_size<N> characters are written
+ */
+template <size_t N>
+constexpr void encode_z85(const unsigned char input[], unsigned char output[]) {
+  static_assert(N % 4 == 0, "Z85 encodes multiples of 4 bytes");
+  
+  Z85_UNROLL
+  for(size_t i = 0; i < N; i += 4) {
+    uint32_t value = (uint32_t) input[i] << 24 | (uint32_t) input[i + 1] << 16 | (uint32_t) input[i + 2] << 8 | input[i + 3];
+    
+    output[4] = z85_encode_table[value % 85]; value /= 85;
+    output[3] = z85_encode_table[value % 85]; value /= 85;
+    output[2] = z85_encode_table[value % 85]; value /= 85;
+    output[1] = z85_encode_table[value % 85]; value /= 85;
+    output[0] = z85_encode_table[value];
+    output += 5;
+  }
+}
+
+/* decode_z85<N>:
+ *   Description:
+ *     Converts exactly z85_encoded_size<N> characters back to N bytes. Errors are accumulated without branches
+ *     and checked once at the end
+ *   Parameters:
+ *     input - Pointer to z85_encoded_size<N> characters (char or unsigned char)
+ *     output - Pointer to output, N bytes are written. Contents are unspecified when the input is rejected
+ *   Returns:
+ *     true if the input was valid
+ */
+template <size_t N, typename Char>
+constexpr bool decode_z85(const Char input[], unsigned char output[]) {
+  static_assert(N % 4 == 0, "Z85 decodes to multiples of 4 bytes");
+  
+  unsigned char error = 0;
+  uint64_t overflow = 0;
+  
+  Z85_UNROLL
+  for(size_t i = 0; i < N; i += 4) {
+    unsigned char a = z85_decode_table[(unsigned char) input[0]];
+    unsigned char b = z85_decode_table[(unsigned char) input[1]];
+    unsigned char c = z85_decode_table[(unsigned char) input[2]];
+    unsigned char d = z85_decode_table[(unsigned char) input[3]];
+    unsigned char e = z85_decode_table[(unsigned char) input[4]];
+    error |= a | b | c | d | e;
+    
+    uint64_t value = (uint64_t) (((a*85u + b)*85u + c)*85u + d)*85u + e;
+    overflow |= value >> 32;
+    
+    output[i] = value >> 24;
+    output[i + 1] = value >> 16;
+    output[i + 2] = value >> 8;
+    output[i + 3] = value;
+    input += 5;
+  }
+  
+  // Digits are below 85, so error only reaches 128 if a character was outside the alphabet
+  return !(error & 0x80) && overflow == 0;
+}
+
+#endif // __cplusplus >= 201703L
+
+#endif // __cplusplus
+
+#endif // ifndef
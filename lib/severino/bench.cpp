@@ -0,0 +1,288 @@
+// Benchmark of the signature check in mqtt_callback(). Build and run with `make bench`
+//
+// Compares the old check (encode the computed tag and compare characters with an early exit) with decoding
+// the received signature once and comparing raw tags with constant_time_equal(). BLAKE2s costs the same in
+// both and is left out. Reports cycles per verification on x86 (nanoseconds elsewhere), and how the time of
+// each compare depends on where the first difference is. Then times BLAKE2s on a command, keyed from scratch
+// as the Crypto library's reset(key) does and from a precomputed keyed state, and the replay guard under a
+// flood of duplicate commands, through a keyring of 1 and 8 keys, and 64 commands at once with each
+// blake2s_many() kernel. Then what the prefilter stages cost per rejected message, against the MAC
+// they save, the MAC of 16 commands sent as one batch or one by one, and last finding a command by name through
+// a strcmp() chain and the command_table hash
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "base64.hpp"
+#include "blake2s.hpp"
+#include "z85.hpp"
+#include "constant_time.hpp"
+#include "replay_guard.hpp"
+#include "prefilter.hpp"
+#include "registry.hpp"
+#include "frame.hpp"
+#include "keyring.hpp"
+#include "blake2s_multi.hpp"
+
+static const size_t sig_len = 16;
+
+static uint8_t tag[sig_len];                              // Computed by the device
+static uint8_t sig_b64[base64_encoded_size<sig_len>];     // Received, standard base64
+static uint8_t sig_url[base64_encoded_size<sig_len, base64_url_unpadded>];
+static uint8_t sig_z85[z85_encoded_size<sig_len>];
+
+static volatile bool sink;
+
+// Keeps the compiler from hoisting calls with unchanged inputs out of a loop
+static inline void clobber() {
+#if defined(__GNUC__)
+  asm volatile("" : : : "memory");
+#endif
+}
+
+// Timestamp counter on x86, nanoseconds elsewhere
+static unsigned long long ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Median over batches of the ticks per call
+template <typename Call>
+static double measure(Call call) {
+  const unsigned int batches = 21, calls = 10000;
+  double per_call[batches];
+  
+  for(unsigned int b = 0; b < batches; ++b) {
+    unsigned long long start = ticks();
+    for(unsigned int i = 0; i < calls; ++i) clobber(), call();
+    per_call[b] = (double) (ticks() - start)/calls;
+  }
+  
+  std::sort(per_call, per_call + batches);
+  return per_call[batches/2];
+}
+
+static bool early_exit_equal(const uint8_t a[], const uint8_t b[], size_t length) {
+  for(size_t i = 0; i < length; ++i) {
+    if(a[i] != b[i]) return false;
+  }
+  return true;
+}
+
+// Old check_payload(): encode the computed tag in the received format, compare characters
+template <size_t Length, typename Encode>
+static bool reencode_check(const uint8_t sig[], Encode encode) {
+  uint8_t encoded[Length];
+  encode(tag, encoded);
+  return early_exit_equal(encoded, sig, Length);
+}
+
+// New check: decode the received signature once, compare the raw tags
+template <typename Decode>
+static bool decode_check(const uint8_t sig[], Decode decode) {
+  uint8_t received[sig_len];
+  return decode(sig, received) & constant_time_equal(received, tag, sig_len);
+}
+
+int main() {
+  for(size_t i = 0; i < sig_len; ++i) tag[i] = (uint8_t) (i*167 + 13);
+  encode_base64<sig_len>(tag, sig_b64);
+  encode_base64<sig_len, base64_url_unpadded>(tag, sig_url);
+  encode_z85<sig_len>(tag, sig_z85);
+  
+  printf("%-10s %22s %22s\n", "format", "re-encode + early exit", "decode + constant time");
+  
+  printf("%-10s %22.1f %22.1f\n", "base64",
+         measure([] { sink = reencode_check<sizeof(sig_b64)>(sig_b64, [](const uint8_t *in, uint8_t *out) { encode_base64<sig_len>(in, out); }); }),
+         measure([] { sink = decode_check(sig_b64, [](const uint8_t *in, uint8_t *out) { return decode_base64_strict<sig_len>(in, out); }); }));
+  
+  printf("%-10s %22.1f %22.1f\n", "base64url",
+         measure([] { sink = reencode_check<sizeof(sig_url)>(sig_url, [](const uint8_t *in, uint8_t *out) { encode_base64<sig_len, base64_url_unpadded>(in, out); }); }),
+         measure([] { sink = decode_check(sig_url, [](const uint8_t *in, uint8_t *out) { return decode_base64_strict<sig_len, base64_url_unpadded>(in, out); }); }));
+  
+  printf("%-10s %22.1f %22.1f\n", "z85",
+         measure([] { sink = reencode_check<sizeof(sig_z85)>(sig_z85, [](const uint8_t *in, uint8_t *out) { encode_z85<sig_len>(in, out); }); }),
+         measure([] { sink = decode_check(sig_z85, [](const uint8_t *in, uint8_t *out) { return decode_z85<sig_len>(in, out); }); }));
+  
+  // A forged tag that matches up to the position of its first wrong byte
+  printf("\n%-22s %14s %14s\n", "first wrong byte", "early exit", "constant time");
+  static uint8_t forged[sig_len];
+  const size_t positions[] = {0, 5, 10, 15, sig_len};
+  
+  for(size_t p = 0; p < sizeof(positions)/sizeof(positions[0]); ++p) {
+    memcpy(forged, tag, sig_len);
+    if(positions[p] < sig_len) forged[positions[p]] ^= 1;
+    
+    char label[16];
+    if(positions[p] < sig_len) snprintf(label, sizeof(label), "%zu", positions[p]);
+    else snprintf(label, sizeof(label), "none (valid)");
+    
+    printf("%-22s %14.1f %14.1f\n", label, measure([] { sink = early_exit_equal(forged, tag, sig_len); }),
+           measure([] { sink = constant_time_equal(forged, tag, sig_len); }));
+  }
+  
+  // A typical command, signed as sign() does
+  static const uint8_t key[] = "you-will-never-guess-again";
+  static const uint8_t command[] = "liberar:1700000000";
+  static blake2s_state keyed_state;
+  blake2s_init(&keyed_state, sig_len, key, sizeof(key) - 1);
+  blake2s_precompute_key(&keyed_state);
+  
+  printf("\n%-40s %10s\n", "BLAKE2s of an 18-byte command", "per call");
+  printf("%-40s %10.1f\n", "keyed from scratch (2 compressions)", measure([] {
+    blake2s_state state;
+    blake2s_init(&state, sig_len, key, sizeof(key) - 1);
+    blake2s_update(&state, command, sizeof(command) - 1);
+    blake2s_final(&state, tag);
+  }));
+  printf("%-40s %10.1f\n", "copy of precomputed state (1 compression)", measure([] {
+    blake2s_state state = keyed_state;
+    blake2s_update(&state, command, sizeof(command) - 1);
+    blake2s_final(&state, tag);
+  }));
+  
+  // Signing through a keyring does not depend on how many keys it holds or which one is used
+  static keyring<8> one_key, eight_keys;
+  one_key.add(0, key, sizeof(key) - 1, sig_len);
+  for(uint8_t id = 0; id < 8; ++id) {
+    uint8_t other_key[32];
+    for(unsigned int i = 0; i < 32; ++i) other_key[i] = (uint8_t) (id*32 + i);
+    eight_keys.add(id, other_key, sizeof(other_key), sig_len);
+  }
+  printf("%-40s %10.1f\n", "keyring<8> holding 1 key, key 0", measure([] { one_key.sign(0, command, sizeof(command) - 1, tag); }));
+  printf("%-40s %10.1f\n", "keyring<8> holding 8 keys, key 0", measure([] { eight_keys.sign(0, command, sizeof(command) - 1, tag); }));
+  printf("%-40s %10.1f\n", "keyring<8> holding 8 keys, key 7", measure([] { eight_keys.sign(7, command, sizeof(command) - 1, tag); }));
+  
+  // Host batch signing and verification: 64 commands from the same key
+  static uint8_t batch_commands[64][19];
+  static const uint8_t *messages[64];
+  static size_t lengths[64];
+  static uint8_t tags[64*sig_len];
+  static int level;
+  for(unsigned int i = 0; i < 64; ++i) {
+    snprintf((char *) batch_commands[i], sizeof(batch_commands[i]), "liberar:%u", 1700000000 + i);
+    messages[i] = batch_commands[i];
+    lengths[i] = 18;
+  }
+  
+  const char *kernels[] = {"one at a time", "4-way SSE4.1", "8-way AVX2"};
+  printf("\n%-40s %10s\n", "blake2s_many(), 64 commands", "per command");
+  for(level = BLAKE2S_SIMD_NONE; level <= blake2s_simd_level(); ++level) {
+    printf("%-40s %10.1f\n", kernels[level], measure([] { blake2s_many(&keyed_state, messages, lengths, 64, tags, level); })/64);
+  }
+  
+  // The guard as the firmware sets it up, holding 48 commands from the last minute
+  typedef replay_guard<64, 8> guard_type;
+  static guard_type guard(60);
+  static uint8_t seen[48][sig_len];
+  static unsigned int next;
+  const uint32_t now = 1700000000;
+  
+  for(unsigned int i = 0; i < 48; ++i) {
+    blake2s(seen[i], sig_len, (const uint8_t *) &i, sizeof(i), key, sizeof(key) - 1);
+    guard.check(now, now - i, seen[i]);
+  }
+  
+  printf("\n%-40s %10s   (%zu bytes of RAM)\n", "replay_guard<64, 8>::check()", "per call", sizeof(guard));
+  printf("%-40s %10.1f\n", "same duplicate, repeated", measure([] { sink = guard.check(now, now, seen[0]); }));
+  printf("%-40s %10.1f\n", "duplicates of every remembered command", measure([] {
+    next = (next + 1) % 48;
+    sink = guard.check(now, now - next, seen[next]);
+  }));
+  printf("%-40s %10.1f\n", "stale timestamps", measure([] { sink = guard.check(now, now - 3600, seen[0]); }));
+  
+  // The prefilter as the firmware sets it up, from its command table, flooded with messages rejected at each
+  // stage
+  static constexpr command_spec specs[] = {
+    {"liberar", {ARGUMENT_NONE, 0, 0}, NULL}, {"travar", {ARGUMENT_NONE, 0, 0}, NULL},
+    {"abrir", {ARGUMENT_NONE, 0, 0}, NULL}, {"status", {ARGUMENT_NONE, 0, 0}, NULL},
+    {"config", {ARGUMENT_DIGITS, 1, 4}, NULL}, {"reboot", {ARGUMENT_NONE, 0, 0}, NULL},
+    {"chave", {ARGUMENT_TEXT, 2, 66}, NULL}
+  };
+  static constexpr command_table<7> table(specs);
+  static const uint8_t signature_lengths[] = {sizeof(sig_b64), sizeof(sig_url), sizeof(sig_z85)};
+  static prefilter filter("testarhs/porta", table, signature_lengths, 3, '$', token_bucket(5, 200));
+  static prefilter::message found;
+  struct flood { const char *label, *topic, *message; };
+  static const flood floods[] = {
+    {"other topic", "testarhs/outro", "liberar:1700000000$AAAAAAAAAAAAAAAAAAAAAA=="},
+    {"no separator (200 bytes)", "testarhs/porta", NULL},
+    {"signature length", "testarhs/porta", "liberar:1700000000$AAAAAAAAAAAAAAAAAAAAAAA="},
+    {"timestamp format", "testarhs/porta", "liberar:17000x0000$AAAAAAAAAAAAAAAAAAAAAA=="},
+    {"unknown command", "testarhs/porta", "liberat:1700000000$AAAAAAAAAAAAAAAAAAAAAA=="},
+    {"well formed, over the rate", "testarhs/porta", "liberar:1700000000$AAAAAAAAAAAAAAAAAAAAAA=="},
+  };
+  static uint8_t garbage[200];
+  static const flood *current;
+  memset(garbage, 'a', sizeof(garbage));
+  
+  printf("\n%-40s %10s\n", "prefilter, message rejected by", "per call");
+  for(size_t f = 0; f < sizeof(floods)/sizeof(floods[0]); ++f) {
+    current = &floods[f];
+    printf("%-40s %10.1f\n", current->label, measure([] {
+      const uint8_t *payload = current->message ? (const uint8_t *) current->message : garbage;
+      size_t length = current->message ? strlen(current->message) : sizeof(garbage);
+      sink = filter.screen(current->topic, payload, length, found) && filter.admit(0);
+    }));
+  }
+  
+  // The same well-formed command as a binary frame, which needs no scan
+  static prefilter frame_filter("testarhs/porta", table, signature_lengths, 3, '$', token_bucket(5, 200),
+                                "testarhs/porta/bin");
+  static uint8_t frame[frame_min_length];
+  static keyring<1> frame_keys;
+  frame_keys.add(0, (const uint8_t *) "you-will-never-guess-again", 26, frame_tag_length);
+  sign_frame(frame_keys, 0, 0, 1700000000, NULL, 0, frame);
+  printf("%-40s %10.1f\n", "binary frame, over the rate", measure([] {
+    sink = frame_filter.screen_frame("testarhs/porta/bin", frame, sizeof(frame), found) && frame_filter.admit(0);
+  }));
+  
+  // 16 commands as one batch or as 16 frames, each screened and its MAC computed
+  static uint8_t batch[frame_batch_max_length];
+  static size_t batch_length = start_batch(0, 1700000000, batch);
+  for(size_t i = 0; i < frame_max_batch; ++i) batch_length = add_to_batch(batch, batch_length, 0, NULL, 0);
+  batch_length = sign_batch(frame_keys, batch, batch_length);
+  static uint8_t computed[frame_tag_length];
+  printf("\n%-40s %10s\n", "16 commands, screened and verified", "per command");
+  printf("%-40s %10.1f\n", "as 16 frames", measure([] {
+    for(size_t i = 0; i < frame_max_batch; ++i) {
+      clobber();
+      sink = frame_filter.screen_frame("testarhs/porta/bin", frame, sizeof(frame), found) &&
+             frame_keys.sign(0, frame, found.length, computed);
+    }
+  })/frame_max_batch);
+  printf("%-40s %10.1f\n", "as one batch", measure([] {
+    sink = frame_filter.screen_frame("testarhs/porta/bin", batch, batch_length, found) &&
+           frame_keys.sign(0, batch, found.length, computed);
+  })/frame_max_batch);
+  
+  // Looked up by the name of each in turn
+  static const char *received[7];
+  for(size_t n = 0; n < 7; ++n) received[n] = specs[n].name;
+  
+  printf("\n%-40s %10s\n", "finding one of 7 commands", "per call");
+  printf("%-40s %10.1f\n", "strcmp() chain", measure([] {
+    for(size_t n = 0; n < 7; ++n) {
+      clobber();
+      const char *name = received[n];
+      int i = 0;
+      while(i < 7 && strcmp(name, table.names[i]) != 0) ++i;
+      sink = i < 7;
+    }
+  })/7);
+  printf("%-40s %10.1f\n", "command_table::find()", measure([] {
+    for(size_t n = 0; n < 7; ++n) {
+      clobber();
+      const char *name = received[n];
+      sink = table.find((const uint8_t *) name, strlen(name)) >= 0;
+    }
+  })/7);
+  
+  return 0;
+}
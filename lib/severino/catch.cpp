@@ -0,0 +1,1080 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "blake2s.hpp"
+#include "constant_time.hpp"
+#include "replay_guard.hpp"
+#include "command.hpp"
+#include "prefilter.hpp"
+#include "registry.hpp"
+#include "frame.hpp"
+#include "ack.hpp"
+#include "keyring.hpp"
+#include "signer.hpp"
+#include "blake2s_multi.hpp"
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+// Counts heap allocations, operator new included, so tests can check a code path makes none
+#define COUNT_ALLOCATIONS
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+extern "C" void __libc_free(void *pointer);
+static size_t allocations = 0;
+
+extern "C" void *malloc(size_t size) {
+  ++allocations;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+  ++allocations;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+  ++allocations;
+  return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void *pointer) {
+  __libc_free(pointer);
+}
+#endif
+
+TEST_CASE("constant_time_equal()", "[]") {
+  uint8_t a[32], b[32];
+  for(unsigned int i = 0; i < 32; ++i) a[i] = b[i] = (uint8_t) (i*167 + 13);
+  
+  SECTION("Equal arrays") {
+    REQUIRE(constant_time_equal(a, b, 32));
+    REQUIRE(constant_time_equal(a, b, 16));
+    REQUIRE(constant_time_equal(a, b, 0));
+  }
+  
+  SECTION("A difference in any bit of any byte") {
+    for(unsigned int i = 0; i < 32; ++i) {
+      for(unsigned int bit = 0; bit < 8; ++bit) {
+        b[i] ^= 1 << bit;
+        REQUIRE_FALSE(constant_time_equal(a, b, 32));
+        REQUIRE(constant_time_equal(a, b, i));
+        b[i] ^= 1 << bit;
+      }
+    }
+  }
+  
+  SECTION("Differences in every byte") {
+    for(unsigned int i = 0; i < 32; ++i) b[i] = ~a[i];
+    REQUIRE_FALSE(constant_time_equal(a, b, 32));
+    REQUIRE_FALSE(constant_time_equal(a, b, 1));
+  }
+}
+
+// Hex string to bytes, for test vectors
+static void from_hex(const char *hex, uint8_t out[]) {
+  for(size_t i = 0; hex[2*i]; ++i) {
+    unsigned int byte;
+    sscanf(hex + 2*i, "%2x", &byte);
+    out[i] = byte;
+  }
+}
+
+TEST_CASE("BLAKE2s", "[]") {
+  // Vectors from Python's hashlib.blake2s()
+  const uint8_t key[] = "you-will-never-guess-again";
+  const size_t key_length = sizeof(key) - 1;
+  
+  uint8_t message[200];
+  for(unsigned int i = 0; i < 200; ++i) message[i] = (uint8_t) (i*167 + 13);
+  
+  struct { size_t length; const char *digest; } keyed[] = {
+    {0, "a80a81701fecdc484d336cdf76a96e83"},
+    {1, "a998e33c86f08c1e8d25ea2188c2a8d3"},
+    {18, "797b0107566e0b48ec597d11d814f897"},
+    {63, "5ce18204d4f7aebe978a3e3ec8bcfa6a"},
+    {64, "fd2507a982a4f0dfe1604e788489be1b"},
+    {65, "b919da1508b15209dabc84958f845d5c"},
+    {128, "8d7a3d17cb28b45b3f000d867ba22a38"},
+    {200, "5739afa37364d9497e993778d4192fc6"},
+  };
+  
+  uint8_t expected[32], actual[32];
+  
+  SECTION("Unkeyed, RFC 7693 vector") {
+    from_hex("508c5e8c327c14e2e1a72ba34eeb452f37458b209ed63a294d999b4c86675982", expected);
+    blake2s(actual, 32, (const uint8_t *) "abc", 3, 0, 0);
+    REQUIRE(memcmp(actual, expected, 32) == 0);
+  }
+  
+  SECTION("Keyed, 32-byte key and digest") {
+    uint8_t key32[32];
+    for(unsigned int i = 0; i < 32; ++i) key32[i] = i;
+    
+    from_hex("9a7ef35fe2d896cd35ddeb9caf97b12286065630fa89cce0f5a459666bae986c", expected);
+    blake2s(actual, 32, message, 100, key32, 32);
+    REQUIRE(memcmp(actual, expected, 32) == 0);
+  }
+  
+  SECTION("Keyed, 16-byte digest, in one call and in chunks") {
+    for(size_t v = 0; v < sizeof(keyed)/sizeof(keyed[0]); ++v) {
+      from_hex(keyed[v].digest, expected);
+      
+      blake2s(actual, 16, message, keyed[v].length, key, key_length);
+      REQUIRE(memcmp(actual, expected, 16) == 0);
+      
+      for(size_t chunk = 1; chunk <= 70; chunk += 3) {
+        blake2s_state state;
+        blake2s_init(&state, 16, key, key_length);
+        for(size_t offset = 0; offset < keyed[v].length; offset += chunk) {
+          blake2s_update(&state, message + offset, std::min(chunk, keyed[v].length - offset));
+        }
+        blake2s_final(&state, actual);
+        REQUIRE(memcmp(actual, expected, 16) == 0);
+      }
+    }
+  }
+  
+  SECTION("Copies of a precomputed keyed state") {
+    blake2s_state keyed_state;
+    blake2s_init(&keyed_state, 16, key, key_length);
+    blake2s_precompute_key(&keyed_state);
+    
+    // Every non-empty message, twice from the same snapshot
+    for(size_t v = 1; v < sizeof(keyed)/sizeof(keyed[0]); ++v) {
+      from_hex(keyed[v].digest, expected);
+      
+      for(unsigned int repeat = 0; repeat < 2; ++repeat) {
+        blake2s_state state = keyed_state;
+        blake2s_update(&state, message, keyed[v].length);
+        blake2s_final(&state, actual);
+        REQUIRE(memcmp(actual, expected, 16) == 0);
+      }
+    }
+    
+    from_hex("7d6b81add258a999be2bd576e45aac9a", expected);
+    blake2s_state state = keyed_state;
+    blake2s_update(&state, (const uint8_t *) "liberar:1700000000", 18);
+    blake2s_final(&state, actual);
+    REQUIRE(memcmp(actual, expected, 16) == 0);
+    
+    // Without a key there is nothing to precompute
+    blake2s_state unkeyed;
+    blake2s_init(&unkeyed, 32, 0, 0);
+    blake2s_precompute_key(&unkeyed);
+    blake2s_update(&unkeyed, (const uint8_t *) "abc", 3);
+    blake2s_final(&unkeyed, actual);
+    from_hex("508c5e8c327c14e2e1a72ba34eeb452f37458b209ed63a294d999b4c86675982", expected);
+    REQUIRE(memcmp(actual, expected, 32) == 0);
+  }
+}
+
+TEST_CASE("replay_guard", "[]") {
+  typedef replay_guard<16, 4> guard_type;
+  guard_type guard(60);
+  const uint32_t now = 1700000000;
+  
+  // Distinct tags, spread over the table by their first bytes
+  uint8_t tags[64][16];
+  for(unsigned int i = 0; i < 64; ++i) {
+    for(unsigned int j = 0; j < 16; ++j) tags[i][j] = (uint8_t) (i*37 + j*11 + 5);
+  }
+  
+  SECTION("A command is accepted once") {
+    REQUIRE(guard.check(now, now, tags[0]) == guard_type::ACCEPTED);
+    REQUIRE(guard.check(now, now, tags[0]) == guard_type::REPLAYED);
+    REQUIRE(guard.check(now + 30, now, tags[0]) == guard_type::REPLAYED);
+    
+    // Same tag with another timestamp, or another tag with the same timestamp
+    REQUIRE(guard.check(now, now + 1, tags[0]) == guard_type::ACCEPTED);
+    REQUIRE(guard.check(now, now, tags[1]) == guard_type::ACCEPTED);
+  }
+  
+  SECTION("Timestamps outside the window") {
+    REQUIRE(guard.check(now, now - 60, tags[0]) == guard_type::ACCEPTED);
+    REQUIRE(guard.check(now, now + 60, tags[1]) == guard_type::ACCEPTED);
+    REQUIRE(guard.check(now, now - 61, tags[2]) == guard_type::OUTSIDE_WINDOW);
+    REQUIRE(guard.check(now, now + 61, tags[2]) == guard_type::OUTSIDE_WINDOW);
+    REQUIRE(guard.check(now, 0, tags[2]) == guard_type::OUTSIDE_WINDOW);
+    
+    // Once the window has moved on, a replay fails the window check
+    REQUIRE(guard.check(now + 121, now - 60, tags[0]) == guard_type::OUTSIDE_WINDOW);
+  }
+  
+  SECTION("Full probe sequence") {
+    // Tags that all start at slot 0
+    uint8_t colliding[8][16];
+    for(unsigned int i = 0; i < 8; ++i) {
+      memset(colliding[i], 0, 16);
+      colliding[i][8] = i;
+      colliding[i][4] = i;
+    }
+    
+    for(unsigned int i = 0; i < 4; ++i) REQUIRE(guard.check(now, now, colliding[i]) == guard_type::ACCEPTED);
+    REQUIRE(guard.check(now, now, colliding[4]) == guard_type::FULL);
+    for(unsigned int i = 0; i < 4; ++i) REQUIRE(guard.check(now, now, colliding[i]) == guard_type::REPLAYED);
+    
+    // Expired entries are reused
+    REQUIRE(guard.check(now + 61, now + 61, colliding[4]) == guard_type::ACCEPTED);
+    REQUIRE(guard.check(now + 61, now + 61, colliding[4]) == guard_type::REPLAYED);
+  }
+  
+  SECTION("Every remembered command is rejected until it expires") {
+    typedef replay_guard<64, 8> big_guard_type;
+    big_guard_type big(60);
+    unsigned int accepted = 0;
+    
+    for(unsigned int i = 0; i < 64; ++i) accepted += big.check(now, now + i % 10, tags[i]) == big_guard_type::ACCEPTED;
+    for(unsigned int i = 0; i < 64; ++i) REQUIRE(big.check(now + 5, now + i % 10, tags[i]) != big_guard_type::ACCEPTED);
+    REQUIRE(accepted >= 56);
+    
+    big.clear();
+    REQUIRE(big.check(now, now, tags[0]) == big_guard_type::ACCEPTED);
+  }
+}
+
+TEST_CASE("token_bucket", "[]") {
+  token_bucket bucket(3, 100, 1000);
+  
+  SECTION("Bursts up to the capacity, then one per period") {
+    for(unsigned int i = 0; i < 3; ++i) REQUIRE(bucket.take(1000));
+    REQUIRE_FALSE(bucket.take(1000));
+    REQUIRE_FALSE(bucket.take(1099));
+    REQUIRE(bucket.take(1100));
+    REQUIRE_FALSE(bucket.take(1150));
+    REQUIRE(bucket.take(1200));
+  }
+  
+  SECTION("Refills up to the capacity only") {
+    for(unsigned int i = 0; i < 3; ++i) REQUIRE(bucket.take(1000));
+    for(unsigned int i = 0; i < 3; ++i) REQUIRE(bucket.take(100000));
+    REQUIRE_FALSE(bucket.take(100000));
+  }
+  
+  SECTION("millis() wrapping around") {
+    token_bucket wrapping(1, 100, 0xffffffc0);
+    REQUIRE(wrapping.take(0xffffffc0));
+    REQUIRE_FALSE(wrapping.take(0xfffffff0));
+    REQUIRE(wrapping.take(0x24));
+    REQUIRE_FALSE(wrapping.take(0x25));
+  }
+}
+
+TEST_CASE("parse_command()", "[]") {
+  command_view command;
+  
+  // Parses a command given as a string, split at its end
+  struct {
+    command_view &command;
+    bool operator()(const char *text) {
+      command.length = strlen(text);
+      return parse_command((const uint8_t *) text, command);
+    }
+  } parse = {command};
+  
+  SECTION("Timestamps up to 2^32 - 1") {
+    uint32_t value = 7;
+    REQUIRE(parse_uint32((const uint8_t *) "0", 1, value));
+    REQUIRE(value == 0);
+    REQUIRE(parse_uint32((const uint8_t *) "4294967295", 10, value));
+    REQUIRE(value == 4294967295u);
+    REQUIRE(parse_uint32((const uint8_t *) "0004294967295", 13, value));
+    REQUIRE(value == 4294967295u);
+    
+    value = 7;
+    REQUIRE_FALSE(parse_uint32((const uint8_t *) "", 0, value));
+    REQUIRE_FALSE(parse_uint32((const uint8_t *) "4294967296", 10, value));
+    REQUIRE_FALSE(parse_uint32((const uint8_t *) "9999999999", 10, value));
+    REQUIRE_FALSE(parse_uint32((const uint8_t *) "42949672950", 11, value));
+    REQUIRE_FALSE(parse_uint32((const uint8_t *) "12a", 3, value));
+    REQUIRE_FALSE(parse_uint32((const uint8_t *) "-1", 2, value));
+    REQUIRE(value == 7);
+  }
+  
+  SECTION("Fields are found in place") {
+    const char *text = "a.chave:1700000000:-3";
+    REQUIRE(parse(text));
+    REQUIRE(command.key_id == 10);
+    REQUIRE(command.timestamp == 1700000000);
+    REQUIRE(command_name_is((const uint8_t *) text, command, "chave"));
+    REQUIRE_FALSE(command_name_is((const uint8_t *) text, command, "chav"));
+    REQUIRE_FALSE(command_name_is((const uint8_t *) text, command, "chaves"));
+    REQUIRE(std::string(text + command.argument_start, command.argument_length) == "-3");
+    
+    REQUIRE(parse("liberar:0"));
+    REQUIRE(command.timestamp == 0);
+    REQUIRE_FALSE(parse("liberar:99999999999"));
+    REQUIRE_FALSE(parse("liberar:1700000000;"));
+  }
+  
+  SECTION("Only the bytes before the separator are looked at") {
+    const char *text = "liberar:1700000000$liberar:1";
+    REQUIRE(split_command((const uint8_t *) text, strlen(text), '$', 18, command));
+    REQUIRE(command.length == 18);
+    REQUIRE(command.signature_length == 9);
+    REQUIRE(parse_command((const uint8_t *) text, command));
+    REQUIRE(command.timestamp == 1700000000);
+    
+    REQUIRE_FALSE(split_command((const uint8_t *) text, strlen(text), '$', 17, command));
+  }
+}
+
+TEST_CASE("prefilter", "[]") {
+  const char *commands[] = {"liberar", "abrir"};
+  const uint8_t signature_lengths[] = {24, 22};
+  prefilter filter("testarhs/porta", commands, 2, signature_lengths, 2, '$', token_bucket(2, 500));
+  prefilter::message found;
+  
+  // Runs screen() on a message given as a string
+  struct {
+    prefilter &filter;
+    prefilter::message &found;
+    bool operator()(const char *message, const char *topic = "testarhs/porta") {
+      return filter.screen(topic, (const uint8_t *) message, strlen(message), found);
+    }
+  } screen = {filter, found};
+  
+  SECTION("Well formed messages pass and are split") {
+    REQUIRE(screen("liberar:1700000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE(found.name_length == 7);
+    REQUIRE(found.length == 18);
+    REQUIRE(found.signature_length == 24);
+    
+    REQUIRE(screen("abrir:1$ABCDEFGHIJKLMNOPQRSTUV"));
+    REQUIRE(found.name_length == 5);
+    REQUIRE(found.length == 7);
+    REQUIRE(found.signature_length == 22);
+    REQUIRE(found.key_id == 0);
+    REQUIRE(found.argument_length == 0);
+    REQUIRE(found.argument_start == 7);
+    
+    // Key ID and argument
+    REQUIRE(screen("c.abrir:1700000000:+3 0f$ABCDEFGHIJKLMNOPQRSTUV"));
+    REQUIRE(found.key_id == 12);
+    REQUIRE(found.name_start == 2);
+    REQUIRE(found.name_length == 5);
+    REQUIRE(found.argument_start == 19);
+    REQUIRE(found.argument_length == 5);
+    REQUIRE(found.length == 24);
+    
+    REQUIRE(screen("0.liberar:1$ABCDEFGHIJKLMNOPQRSTUV"));
+    REQUIRE(found.key_id == 0);
+    REQUIRE(found.name_start == 2);
+    REQUIRE(found.timestamp == 1);
+    
+    REQUIRE(screen("liberar:4294967295$ABCDEFGHIJKLMNOPQRSTUV"));
+    REQUIRE(found.timestamp == 4294967295u);
+    
+    for(unsigned int s = 0; s < prefilter::STAGES; ++s) REQUIRE(filter.rejected[s] == 0);
+  }
+  
+  SECTION("Each stage rejects and counts") {
+    REQUIRE_FALSE(screen("liberar:1700000000$ABCDEFGHIJKLMNOPQRSTUV==", "testarhs/server"));
+    REQUIRE(filter.rejected[prefilter::TOPIC] == 1);
+    
+    REQUIRE_FALSE(screen("liberar:1700000000"));
+    REQUIRE_FALSE(screen("liberar:1700000000$ABCDEFGHIJKLMNOPQRSTUV="));
+    REQUIRE_FALSE(screen("liberar:1700000000$"));
+    REQUIRE(filter.rejected[prefilter::SIZE] == 3);
+    
+    REQUIRE_FALSE(screen("liberar1700000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen(":1700000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("liberar:$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("liberar:17000x0000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("liberar:-170000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("liberar:17000000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("g.liberar:1700000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("1.:1700000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("liberar:1700000000:\x7f$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("liberar:4294967296$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE(filter.rejected[prefilter::FORMAT] == 10);
+    
+    REQUIRE_FALSE(screen("liberarx:17000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("liber:1700000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE_FALSE(screen("travar:1700000000$ABCDEFGHIJKLMNOPQRSTUV=="));
+    REQUIRE(filter.rejected[prefilter::COMMAND] == 3);
+    
+    REQUIRE(filter.admit(0));
+    REQUIRE(filter.admit(0));
+    REQUIRE_FALSE(filter.admit(0));
+    REQUIRE(filter.admit(500));
+    REQUIRE(filter.rejected[prefilter::RATE] == 1);
+    REQUIRE(filter.admitted == 3);
+    
+    filter.reject(prefilter::FORMAT);
+    REQUIRE(filter.rejected[prefilter::FORMAT] == 11);
+  }
+  
+  SECTION("Built from a command table, names are looked up through its hash") {
+    static constexpr command_spec specs[] = {
+      {"liberar", {ARGUMENT_NONE, 0, 0}, NULL},
+      {"abrir", {ARGUMENT_NONE, 0, 0}, NULL},
+      {"reboot", {ARGUMENT_NONE, 0, 0}, NULL}
+    };
+    static constexpr command_table<3> table(specs);
+    prefilter hashed("testarhs/porta", table, signature_lengths, 2, '$', token_bucket(2, 500));
+    REQUIRE(hashed.lookup != NULL);
+    REQUIRE(hashed.max_length == filter.max_length);
+    
+    // "reboot" is not a prefix of any other name, nor any other of it
+    REQUIRE(hashed.screen("testarhs/porta", (const uint8_t *) "reboot:1700000000$ABCDEFGHIJKLMNOPQRSTUV", 40, found));
+    REQUIRE(found.name_length == 6);
+    REQUIRE(hashed.screen("testarhs/porta", (const uint8_t *) "3.abrir:1700000000$ABCDEFGHIJKLMNOPQRSTUV", 41, found));
+    const char *unknown[] = {
+      "reboo:1700000000$ABCDEFGHIJKLMNOPQRSTUV", "rebootx:1700000000$ABCDEFGHIJKLMNOPQRSTUV",
+      "Reboot:1700000000$ABCDEFGHIJKLMNOPQRSTUV", "liberarr:17000$ABCDEFGHIJKLMNOPQRSTUV"
+    };
+    for(size_t i = 0; i < 4; ++i) {
+      INFO(unknown[i]);
+      REQUIRE_FALSE(hashed.screen("testarhs/porta", (const uint8_t *) unknown[i], strlen(unknown[i]), found));
+    }
+    REQUIRE(hashed.rejected[prefilter::COMMAND] == 4);
+    for(unsigned int s = 0; s < prefilter::STAGES; ++s) {
+      if(s != prefilter::COMMAND) REQUIRE(hashed.rejected[s] == 0);
+    }
+  }
+  
+  SECTION("The separator is only searched for where it can be") {
+    char message[300];
+    memset(message, 'a', sizeof(message));
+    memcpy(message + 250, "$ABCDEFGHIJKLMNOPQRSTUV", 23);
+    REQUIRE_FALSE(filter.screen("testarhs/porta", (const uint8_t *) message, 273, found));
+    REQUIRE(filter.rejected[prefilter::SIZE] == 1);
+  }
+}
+
+// Handlers for the command_registry test, which record their calls
+static size_t handled = 0;
+static uint32_t fake_clock = 0;
+
+static bool handle_ok(const uint8_t[], const command_view &) {
+  ++handled;
+  fake_clock += 7;
+  return true;
+}
+
+static bool handle_fail(const uint8_t[], const command_view &) {
+  ++handled;
+  fake_clock += 3;
+  return false;
+}
+
+static uint32_t read_fake_clock() {
+  return fake_clock;
+}
+
+TEST_CASE("command_registry", "[]") {
+  static constexpr command_spec specs[] = {
+    {"liberar", {ARGUMENT_NONE, 0, 0}, handle_ok},
+    {"travar", {ARGUMENT_NONE, 0, 0}, handle_ok},
+    {"abrir", {ARGUMENT_NONE, 0, 0}, handle_ok},
+    {"status", {ARGUMENT_NONE, 0, 0}, handle_ok},
+    {"config", {ARGUMENT_DIGITS, 1, 4}, handle_ok},
+    {"reboot", {ARGUMENT_NONE, 0, 0}, handle_fail},
+    {"chave", {ARGUMENT_TEXT, 2, 66}, handle_ok},
+    {"cor", {ARGUMENT_HEX, 6, 6}, handle_ok}
+  };
+  static constexpr command_table<8> table(specs);
+  static_assert(table.perfect, "Seed found at compile time");
+  command_registry<8> registry(table);
+  handled = 0;
+  
+  // Parses and dispatches a command given as a string
+  struct {
+    command_registry<8> &registry;
+    command_registry<8>::result operator()(const char *text) {
+      command_view command;
+      command.length = strlen(text);
+      REQUIRE(parse_command((const uint8_t *) text, command));
+      return registry.dispatch((const uint8_t *) text, command, read_fake_clock);
+    }
+  } dispatch = {registry};
+  
+  SECTION("Every name is found, and only them") {
+    REQUIRE(table.slot_count == 16);
+    for(size_t i = 0; i < 8; ++i) {
+      REQUIRE(table.find((const uint8_t *) specs[i].name, strlen(specs[i].name)) == (int) i);
+      REQUIRE(strcmp(table.names[i], specs[i].name) == 0);
+    }
+    const char *others[] = {"", "liberarr", "Liberar", "libera", "c", "chav", "statu", "x", "configs"};
+    for(size_t i = 0; i < sizeof(others)/sizeof(others[0]); ++i) {
+      REQUIRE(table.find((const uint8_t *) others[i], strlen(others[i])) == -1);
+    }
+    REQUIRE(table.find((const uint8_t *) "liberar\0", 8) == -1);
+  }
+  
+  SECTION("Arguments are checked against the schema") {
+    REQUIRE(dispatch("liberar:1") == command_registry<8>::COMMAND_DONE);
+    REQUIRE(dispatch("liberar:1:x") == command_registry<8>::COMMAND_BAD_ARGUMENT);
+    REQUIRE(dispatch("config:1:60") == command_registry<8>::COMMAND_DONE);
+    REQUIRE(dispatch("config:1") == command_registry<8>::COMMAND_BAD_ARGUMENT);
+    REQUIRE(dispatch("config:1:12345") == command_registry<8>::COMMAND_BAD_ARGUMENT);
+    REQUIRE(dispatch("config:1:6a") == command_registry<8>::COMMAND_BAD_ARGUMENT);
+    REQUIRE(dispatch("cor:1:00ff7f") == command_registry<8>::COMMAND_DONE);
+    REQUIRE(dispatch("cor:1:00FF7F") == command_registry<8>::COMMAND_BAD_ARGUMENT);
+    REQUIRE(dispatch("chave:1:-3") == command_registry<8>::COMMAND_DONE);
+    REQUIRE(dispatch("chave:1:-") == command_registry<8>::COMMAND_BAD_ARGUMENT);
+    REQUIRE(dispatch("travar2:1") == command_registry<8>::COMMAND_UNKNOWN);
+    REQUIRE(handled == 4);
+  }
+  
+  SECTION("Invocations and latency are counted per command") {
+    REQUIRE(dispatch("liberar:1") == command_registry<8>::COMMAND_DONE);
+    REQUIRE(dispatch("liberar:2") == command_registry<8>::COMMAND_DONE);
+    REQUIRE(dispatch("liberar:3:x") == command_registry<8>::COMMAND_BAD_ARGUMENT);
+    REQUIRE(dispatch("reboot:1") == command_registry<8>::COMMAND_FAILED);
+    
+    REQUIRE(registry.stats[0].calls == 3);
+    REQUIRE(registry.stats[0].bad_arguments == 1);
+    REQUIRE(registry.stats[0].failures == 0);
+    REQUIRE(registry.stats[0].total_time == 14);
+    REQUIRE(registry.stats[0].max_time == 7);
+    REQUIRE(registry.stats[5].calls == 1);
+    REQUIRE(registry.stats[5].failures == 1);
+    REQUIRE(registry.stats[5].total_time == 3);
+    REQUIRE(registry.stats[1].calls == 0);
+    
+    registry.clear();
+    REQUIRE(registry.stats[0].calls == 0);
+  }
+}
+
+TEST_CASE("keyring", "[]") {
+  keyring<4> keys;
+  const uint8_t key[] = "you-will-never-guess-again";
+  const uint8_t other_key[] = "another key";
+  const uint8_t message[] = "liberar:1700000000";
+  uint8_t tag[16], expected[16];
+  
+  SECTION("Signs as a one-shot keyed BLAKE2s with the key of the slot") {
+    REQUIRE(keys.add(0, key, sizeof(key) - 1, 16));
+    REQUIRE(keys.add(3, other_key, sizeof(other_key) - 1, 16));
+    
+    REQUIRE(keys.sign(0, message, sizeof(message) - 1, tag));
+    from_hex("7d6b81add258a999be2bd576e45aac9a", expected);
+    REQUIRE(memcmp(tag, expected, 16) == 0);
+    
+    REQUIRE(keys.sign(3, message, sizeof(message) - 1, tag));
+    blake2s(expected, 16, message, sizeof(message) - 1, other_key, sizeof(other_key) - 1);
+    REQUIRE(memcmp(tag, expected, 16) == 0);
+  }
+  
+  SECTION("Inactive and out of range IDs") {
+    REQUIRE_FALSE(keys.contains(0));
+    REQUIRE_FALSE(keys.sign(1, message, sizeof(message) - 1, tag));
+    REQUIRE_FALSE(keys.add(4, key, sizeof(key) - 1, 16));
+    REQUIRE_FALSE(keys.add(1, key, 0, 16));
+    REQUIRE_FALSE(keys.add(1, key, 33, 16));
+    REQUIRE_FALSE(keys.add(1, key, 16, 0));
+    REQUIRE_FALSE(keys.contains(4));
+    REQUIRE_FALSE(keys.retire(4));
+    
+    REQUIRE(keys.add(1, key, sizeof(key) - 1, 16));
+    REQUIRE(keys.retire(1));
+    REQUIRE_FALSE(keys.retire(1));
+    REQUIRE_FALSE(keys.sign(1, message, sizeof(message) - 1, tag));
+    
+    REQUIRE(keys.add(1, key, sizeof(key) - 1, 16));
+    REQUIRE(keys.add(1, other_key, sizeof(other_key) - 1, 16));
+    REQUIRE(keys.sign(1, message, sizeof(message) - 1, tag));
+    blake2s(expected, 16, message, sizeof(message) - 1, other_key, sizeof(other_key) - 1);
+    REQUIRE(memcmp(tag, expected, 16) == 0);
+    
+    keys.clear();
+    REQUIRE_FALSE(keys.contains(1));
+  }
+  
+  SECTION("Masking a key") {
+    const uint8_t context[] = "chave:1700000000:+1";
+    uint8_t new_key[32], masked[32], pad[32];
+    for(unsigned int i = 0; i < 32; ++i) new_key[i] = (uint8_t) i;
+    memcpy(masked, new_key, 32);
+    
+    REQUIRE_FALSE(keys.mask_key(0, context, sizeof(context) - 1, masked));
+    REQUIRE(keys.add(0, key, sizeof(key) - 1, 16));
+    REQUIRE(keys.mask_key(0, context, sizeof(context) - 1, masked));
+    
+    // The pad is the tags of context followed by the block number
+    uint8_t block[sizeof(context)];
+    memcpy(block, context, sizeof(context) - 1);
+    for(uint8_t b = 0; b < 2; ++b) {
+      block[sizeof(context) - 1] = b;
+      blake2s(pad + 16*b, 16, block, sizeof(block), key, sizeof(key) - 1);
+    }
+    for(unsigned int i = 0; i < 32; ++i) REQUIRE(masked[i] == (new_key[i] ^ pad[i]));
+    
+    REQUIRE(keys.mask_key(0, context, sizeof(context) - 1, masked));
+    REQUIRE(memcmp(masked, new_key, 32) == 0);
+  }
+}
+
+TEST_CASE("sign_command()", "[]") {
+  keyring<16> keys;
+  const uint8_t key[] = "you-will-never-guess-again";
+  uint8_t other_key[32];
+  for(unsigned int i = 0; i < 32; ++i) other_key[i] = (uint8_t) i;
+  keys.add(0, key, sizeof(key) - 1, signature_tag_length);
+  keys.add(3, other_key, sizeof(other_key), signature_tag_length);
+  
+  const uint8_t command[] = "liberar:1700000000";
+  uint8_t output[64];
+  REQUIRE(signed_command_max_length(sizeof(command) - 1) <= sizeof(output));
+  
+  // Signatures from Python's hashlib.blake2s()
+  SECTION("Key 0, as in the older format") {
+    size_t length = sign_command(keys, 0, command, sizeof(command) - 1, SIGNATURE_BASE64, output);
+    REQUIRE(std::string((char *) output, length) == "liberar:1700000000$fWuBrdJYqZm+K9V25Fqsmg==");
+    
+    length = sign_command(keys, 0, command, sizeof(command) - 1, SIGNATURE_BASE64URL, output);
+    REQUIRE(std::string((char *) output, length) == "liberar:1700000000$fWuBrdJYqZm-K9V25Fqsmg");
+  }
+  
+  SECTION("Other keys carry their ID") {
+    size_t length = sign_command(keys, 3, command, sizeof(command) - 1, SIGNATURE_BASE64, output);
+    REQUIRE(std::string((char *) output, length) == "3.liberar:1700000000$LriOHCx+F1mBrBZ6U3PS3Q==");
+    
+    REQUIRE(sign_command(keys, 4, command, sizeof(command) - 1, SIGNATURE_BASE64, output) == 0);
+    REQUIRE(sign_command(keys, 16, command, sizeof(command) - 1, SIGNATURE_BASE64, output) == 0);
+  }
+  
+  SECTION("What the firmware does with it") {
+    const char *commands[] = {"liberar"};
+    const uint8_t lengths[] = {24, 22, 20};
+    prefilter filter("testarhs/porta", commands, 1, lengths, 3, '$', token_bucket(1, 1000));
+    prefilter::message found;
+    const signature_format formats[] = {SIGNATURE_BASE64, SIGNATURE_BASE64URL, SIGNATURE_Z85};
+    
+    for(size_t f = 0; f < 3; ++f) {
+      size_t length = sign_command(keys, 3, command, sizeof(command) - 1, formats[f], output);
+      REQUIRE(filter.screen("testarhs/porta", output, length, found));
+      REQUIRE(found.key_id == 3);
+      
+      signature_format format;
+      uint8_t tag[signature_tag_length], expected[signature_tag_length];
+      REQUIRE(signature_format_of(found.signature_length, format));
+      REQUIRE(format == formats[f]);
+      REQUIRE(decode_signature(format, output + found.length + 1, tag));
+      REQUIRE(keys.sign(found.key_id, output, found.length, expected));
+      REQUIRE(constant_time_equal(tag, expected, signature_tag_length));
+      
+      // Signed part or signature changed
+      output[5] ^= 1;
+      REQUIRE(keys.sign(found.key_id, output, found.length, expected));
+      REQUIRE_FALSE(constant_time_equal(tag, expected, signature_tag_length));
+    }
+    
+    signature_format format;
+    REQUIRE_FALSE(signature_format_of(23, format));
+  }
+}
+
+TEST_CASE("Binary frames", "[]") {
+  keyring<16> keys;
+  const uint8_t key[] = "you-will-never-guess-again";
+  keys.add(0, key, sizeof(key) - 1, signature_tag_length);
+  keys.add(3, key, 16, signature_tag_length);
+  const char *commands[] = {"liberar", "chave"};
+  const uint8_t lengths[] = {24, 22};
+  prefilter filter("testarhs/porta", commands, 2, lengths, 2, '$', token_bucket(1, 1000), "testarhs/porta/bin");
+  prefilter::message found;
+  uint8_t frame[frame_batch_max_length + 1];
+  
+  SECTION("Layout, and half the size of the text command") {
+    size_t length = sign_frame(keys, 0, 0, 1700000000, NULL, 0, frame);
+    REQUIRE(length == 24);
+    const uint8_t header[] = {1, 0, 0, 0x65, 0x53, 0xf1, 0x00, 0};
+    REQUIRE(memcmp(frame, header, sizeof(header)) == 0);
+    
+    uint8_t text[64];
+    REQUIRE(sign_command(keys, 0, (const uint8_t *) "liberar:1700000000", 18, SIGNATURE_BASE64, text) == 43);
+    
+    REQUIRE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    REQUIRE(found.opcode == 0);
+    REQUIRE(found.key_id == 0);
+    REQUIRE(found.timestamp == 1700000000);
+    REQUIRE(found.length == 8);
+    REQUIRE(found.argument_length == 0);
+    REQUIRE(check_signature(keys, found.key_id, frame, found.length, frame + found.length));
+    
+    // The tag is what the key gives for the signed part
+    uint8_t tag[signature_tag_length];
+    keys.sign(0, frame, 8, tag);
+    REQUIRE(memcmp(tag, frame + 8, sizeof(tag)) == 0);
+  }
+  
+  SECTION("Key ID and argument") {
+    size_t length = sign_frame(keys, 3, 1, 4294967295u, (const uint8_t *) "-3", 2, frame);
+    REQUIRE(length == 26);
+    REQUIRE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    REQUIRE(found.opcode == 1);
+    REQUIRE(found.key_id == 3);
+    REQUIRE(found.timestamp == 4294967295u);
+    REQUIRE(std::string((char *) frame + found.argument_start, found.argument_length) == "-3");
+    REQUIRE(check_signature(keys, found.key_id, frame, found.length, frame + found.length));
+    
+    frame[9] = '4';
+    REQUIRE_FALSE(check_signature(keys, found.key_id, frame, found.length, frame + found.length));
+    
+    REQUIRE(sign_frame(keys, 4, 1, 1, NULL, 0, frame) == 0);
+    REQUIRE(sign_frame(keys, 0, 1, 1, frame, command_max_argument_length + 1, frame) == 0);
+  }
+  
+  SECTION("Each stage rejects and counts") {
+    size_t length = sign_frame(keys, 0, 0, 1700000000, (const uint8_t *) "ab", 2, frame);
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta", frame, length, found));
+    REQUIRE_FALSE(filter.screen("testarhs/porta/bin", frame, length, found));
+    REQUIRE(filter.rejected[prefilter::TOPIC] == 2);
+    
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, 23, found));
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, frame_batch_max_length + 1, found));
+    REQUIRE(filter.rejected[prefilter::SIZE] == 2);
+    
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, length - 1, found));
+    frame[0] = 2;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    frame[0] = 1;
+    frame[2] = 16;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    frame[2] = 0;
+    frame[8] = '\n';
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    frame[8] = 'a';
+    REQUIRE(filter.rejected[prefilter::FORMAT] == 4);
+    
+    frame[1] = 2;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    REQUIRE(filter.rejected[prefilter::COMMAND] == 1);
+    
+    prefilter text_only("testarhs/porta", commands, 2, lengths, 2, '$', token_bucket(1, 1000));
+    frame[1] = 0;
+    REQUIRE_FALSE(text_only.screen_frame("testarhs/porta/bin", frame, length, found));
+    REQUIRE(text_only.rejected[prefilter::TOPIC] == 1);
+  }
+  
+  SECTION("Dispatched by opcode") {
+    static constexpr command_spec specs[] = {
+      {"liberar", {ARGUMENT_NONE, 0, 0}, handle_ok},
+      {"chave", {ARGUMENT_TEXT, 2, 66}, handle_fail}
+    };
+    static constexpr command_table<2> table(specs);
+    command_registry<2> registry(table);
+    handled = 0;
+    
+    size_t length = sign_frame(keys, 0, 0, 1700000000, NULL, 0, frame);
+    REQUIRE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    REQUIRE(registry.dispatch_opcode(frame, found, read_fake_clock) == command_registry<2>::COMMAND_DONE);
+    
+    length = sign_frame(keys, 0, 1, 1700000000, (const uint8_t *) "-", 1, frame);
+    REQUIRE(filter.screen_frame("testarhs/porta/bin", frame, length, found));
+    REQUIRE(registry.dispatch_opcode(frame, found, read_fake_clock) == command_registry<2>::COMMAND_BAD_ARGUMENT);
+    
+    found.opcode = 2;
+    REQUIRE(registry.dispatch_opcode(frame, found, read_fake_clock) == command_registry<2>::COMMAND_UNKNOWN);
+    REQUIRE(handled == 1);
+    REQUIRE(registry.stats[0].calls == 1);
+    REQUIRE(registry.stats[1].bad_arguments == 1);
+  }
+}
+
+TEST_CASE("Batches", "[]") {
+  keyring<16> keys;
+  const uint8_t key[] = "you-will-never-guess-again";
+  keys.add(2, key, sizeof(key) - 1, signature_tag_length);
+  const char *commands[] = {"liberar", "config", "reboot"};
+  const uint8_t lengths[] = {24, 22};
+  prefilter filter("testarhs/porta", commands, 3, lengths, 2, '$', token_bucket(1, 1000), "testarhs/porta/bin");
+  prefilter::message batch, command;
+  uint8_t frame[frame_batch_max_length + frame_tag_length];
+  
+  size_t length = start_batch(2, 1700000000, frame);
+  length = add_to_batch(frame, length, 0, NULL, 0);
+  length = add_to_batch(frame, length, 1, (const uint8_t *) "60", 2);
+  length = add_to_batch(frame, length, 1, (const uint8_t *) "x", 1);
+  length = add_to_batch(frame, length, 2, NULL, 0);
+  REQUIRE(length == 7 + 2 + 4 + 3 + 2);
+  size_t signed_length = sign_batch(keys, frame, length);
+  REQUIRE(signed_length == length + 16);
+  
+  SECTION("One MAC over all the commands, walked in order") {
+    REQUIRE(filter.screen_frame("testarhs/porta/bin", frame, signed_length, batch));
+    REQUIRE(batch.opcode == 4);
+    REQUIRE(batch.key_id == 2);
+    REQUIRE(batch.timestamp == 1700000000);
+    REQUIRE(batch.length == length);
+    REQUIRE(check_signature(keys, batch.key_id, frame, batch.length, frame + batch.length));
+    
+    const uint8_t opcodes[] = {0, 1, 1, 2};
+    const char *arguments[] = {"", "60", "x", ""};
+    size_t position = frame_batch_header_length, n = 0;
+    while(next_batch_command(frame, batch, position, command)) {
+      REQUIRE(n < 4);
+      REQUIRE(command.opcode == opcodes[n]);
+      REQUIRE(command.key_id == 2);
+      REQUIRE(command.timestamp == 1700000000);
+      REQUIRE(std::string((char *) frame + command.argument_start, command.argument_length) == arguments[n]);
+      ++n;
+    }
+    REQUIRE(n == 4);
+    
+    frame[10] ^= 1;
+    REQUIRE_FALSE(check_signature(keys, batch.key_id, frame, batch.length, frame + batch.length));
+  }
+  
+  SECTION("Run in order, with a result each") {
+    static constexpr command_spec specs[] = {
+      {"liberar", {ARGUMENT_NONE, 0, 0}, handle_ok},
+      {"config", {ARGUMENT_DIGITS, 1, 4}, handle_ok},
+      {"reboot", {ARGUMENT_NONE, 0, 0}, handle_fail}
+    };
+    static constexpr command_table<3> table(specs);
+    command_registry<3> registry(table);
+    typedef command_registry<3> registry_type;
+    const registry_type::result expected[] = {
+      registry_type::COMMAND_DONE, registry_type::COMMAND_DONE, registry_type::COMMAND_BAD_ARGUMENT, registry_type::COMMAND_FAILED
+    };
+    
+    REQUIRE(filter.screen_frame("testarhs/porta/bin", frame, signed_length, batch));
+    size_t position = frame_batch_header_length, n = 0;
+    while(next_batch_command(frame, batch, position, command)) {
+      REQUIRE(registry.dispatch_opcode(frame, command, read_fake_clock) == expected[n++]);
+    }
+    REQUIRE(registry.stats[1].calls == 2);
+    REQUIRE(registry.stats[1].bad_arguments == 1);
+  }
+  
+  SECTION("Malformed batches are rejected") {
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, signed_length - 1, batch));
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, signed_length + 1, batch));
+    frame[1] = 5;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, signed_length, batch));
+    frame[1] = 3;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, signed_length, batch));
+    frame[1] = 0;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, signed_length, batch));
+    frame[1] = 4;
+    frame[12] = 0x7f;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, signed_length, batch));
+    frame[12] = 'x';
+    REQUIRE(filter.rejected[prefilter::FORMAT] == 6);
+    
+    frame[9] = 3;
+    REQUIRE_FALSE(filter.screen_frame("testarhs/porta/bin", frame, signed_length, batch));
+    REQUIRE(filter.rejected[prefilter::COMMAND] == 1);
+  }
+  
+  SECTION("Batches are bounded") {
+    uint8_t argument[command_max_argument_length + 1];
+    memset(argument, 'a', sizeof(argument));
+    size_t full = start_batch(2, 1, frame);
+    REQUIRE(sign_batch(keys, frame, full) == 0);
+    REQUIRE(add_to_batch(frame, full, 0, argument, sizeof(argument)) == 0);
+    full = add_to_batch(frame, full, 0, argument, command_max_argument_length);
+    full = add_to_batch(frame, full, 0, argument, command_max_argument_length);
+    REQUIRE(full == 7 + 2*82);
+    REQUIRE(add_to_batch(frame, full, 0, argument, command_max_argument_length) == 0);
+    REQUIRE(add_to_batch(frame, full, 0, argument, 4) == 0);
+    REQUIRE(add_to_batch(frame, full, 0, argument, 3) == full + 5);
+    
+    full = start_batch(2, 1, frame);
+    for(size_t i = 0; i < frame_max_batch; ++i) REQUIRE((full = add_to_batch(frame, full, 0, NULL, 0)));
+    REQUIRE(add_to_batch(frame, full, 0, NULL, 0) == 0);
+    full = sign_batch(keys, frame, full);
+    REQUIRE(full <= frame_batch_max_length);
+    REQUIRE(filter.screen_frame("testarhs/porta/bin", frame, full, batch));
+    REQUIRE(batch.opcode == frame_max_batch);
+    
+    frame[2] = 3;
+    REQUIRE(sign_batch(keys, frame, full - 16) == 0);
+  }
+}
+
+TEST_CASE("Acknowledgements", "[]") {
+  command_ack ack, read;
+  const uint8_t tag[] = {0x7d, 0x6b, 0x81, 0xad, 0xd2, 0x58, 0xa9, 0x99};
+  memcpy(ack.correlation, tag, sizeof(tag));
+  ack.index = 0;
+  ack.result = ACK_DONE;
+  ack.received = 1000;
+  ack.verified = 1525;
+  ack.done = 0;
+  char text[ack_max_length + 1];
+  
+  SECTION("Written and read back") {
+    size_t length = format_ack(ack, text);
+    REQUIRE(length == strlen(text));
+    REQUIRE(std::string(text) == "ack:7d6b81add258a999:0:1000:1525:0");
+    REQUIRE(parse_ack(text, strlen(text), read));
+    REQUIRE(memcmp(read.correlation, tag, sizeof(tag)) == 0);
+    REQUIRE(read.index == 0);
+    REQUIRE(read.result == ACK_DONE);
+    REQUIRE(read.received == 1000);
+    REQUIRE(read.verified == 1525);
+    REQUIRE(read.done == 0);
+    
+    ack.index = 16;
+    ack.result = ACK_BAD_ARGUMENT;
+    length = format_ack(ack, text);
+    REQUIRE(length == strlen(text));
+    REQUIRE(std::string(text) == "ack:7d6b81add258a999.16:2:1000:1525:0");
+    REQUIRE(parse_ack(text, strlen(text), read));
+    REQUIRE(read.index == 16);
+    REQUIRE(read.result == ACK_BAD_ARGUMENT);
+  }
+  
+  SECTION("The longest fits") {
+    ack.index = 255;
+    ack.result = ACK_BEFORE_BOOT;
+    ack.received = ack.verified = ack.done = 4294967295u;
+    size_t length = format_ack(ack, text);
+    REQUIRE(length <= ack_max_length);
+    REQUIRE(parse_ack(text, length, read));
+    REQUIRE(read.index == 255);
+    REQUIRE(read.done == 4294967295u);
+  }
+  
+  SECTION("Malformed acknowledgements are rejected") {
+    const char *malformed[] = {
+      "", "ack:", "ack:7d6b81add258a999", "ack:7d6b81add258a999:0:1000:1525", "ack:7d6b81add258a999:0:1000:1525:0:1",
+      "ack:7d6b81add258a99:0:1000:1525:0", "ack:7D6B81ADD258A999:0:1000:1525:0", "akc:7d6b81add258a999:0:1000:1525:0",
+      "ack:7d6b81add258a999:9:1000:1525:0", "ack:7d6b81add258a999.0:0:1000:1525:0", "ack:7d6b81add258a999.256:0:1:2:3",
+      "ack:7d6b81add258a999:0:1000::0", "ack:7d6b81add258a999:0:4294967296:1:2", "ack:7d6b81add258a999:0:1000:1525:0x"
+    };
+    for(size_t i = 0; i < sizeof(malformed)/sizeof(malformed[0]); ++i) {
+      INFO(malformed[i]);
+      REQUIRE_FALSE(parse_ack(malformed[i], strlen(malformed[i]), read));
+    }
+  }
+}
+
+#ifdef COUNT_ALLOCATIONS
+TEST_CASE("Authenticating a command allocates nothing", "[]") {
+  keyring<8> keys;
+  const uint8_t key[] = "you-will-never-guess-again";
+  keys.add(0, key, sizeof(key) - 1, signature_tag_length);
+  const char *commands[] = {"liberar", "chave"};
+  const uint8_t lengths[] = {24, 22, 20};
+  prefilter filter("testarhs/porta", commands, 2, lengths, 3, '$', token_bucket(1000, 1));
+  replay_guard<64, 8> guard(60);
+  
+  // Valid, forged, replayed, malformed and from unknown keys, as the firmware receives them
+  std::vector<std::string> messages;
+  uint8_t output[128];
+  for(uint32_t i = 0; i < 16; ++i) {
+    std::string command = "liberar:" + std::to_string(1700000000 + i);
+    size_t length = sign_command(keys, 0, (const uint8_t *) command.data(), command.size(), (signature_format) (i%3), output);
+    messages.push_back(std::string((char *) output, length));
+    messages.push_back(messages.back());
+    output[8] ^= 1;
+    messages.push_back(std::string((char *) output, length));
+  }
+  messages.push_back("liberar:4294967296$ABCDEFGHIJKLMNOPQRSTUV==");
+  messages.push_back("5.liberar:1700000000$ABCDEFGHIJKLMNOPQRSTUV==");
+  messages.push_back("liberar:1700000000$ABCDEFGHIJKLMNOPQRSTU!==");
+  
+  size_t before = allocations, authenticated = 0, replayed = 0, forged = 0, filtered = 0;
+  for(const std::string &message : messages) {
+    const uint8_t *payload = (const uint8_t *) message.data();
+    command_view found;
+    uint8_t tag[signature_tag_length];
+    if(!filter.screen("testarhs/porta", payload, message.size(), found) || !decode_message_signature(payload, found, tag) ||
+       !keys.contains(found.key_id) || !filter.admit(0)) ++filtered;
+    else if(!check_signature(keys, found.key_id, payload, found.length, tag)) ++forged;
+    else if(guard.check(1700000010, found.timestamp, tag) != replay_guard<64, 8>::ACCEPTED) ++replayed;
+    else if(command_name_is(payload, found, "liberar")) ++authenticated;
+  }
+  size_t made = allocations - before;
+  
+  REQUIRE(made == 0);
+  REQUIRE(authenticated == 16);
+  REQUIRE(replayed == 16);
+  REQUIRE(forged == 16);
+  REQUIRE(filtered == 3);
+}
+#endif
+
+TEST_CASE("blake2s_many()", "[]") {
+  // Every kernel against one message at a time, for lengths around the block boundaries
+  const uint8_t key[] = "you-will-never-guess-again";
+  blake2s_state keyed, unkeyed;
+  blake2s_init(&keyed, 16, key, sizeof(key) - 1);
+  blake2s_precompute_key(&keyed);
+  blake2s_init(&unkeyed, 32, NULL, 0);
+  
+  uint8_t data[300];
+  for(unsigned int i = 0; i < sizeof(data); ++i) data[i] = (uint8_t) (i*167 + 13);
+  
+  const uint8_t *messages[37];
+  size_t lengths[37];
+  for(unsigned int i = 0; i < 37; ++i) {
+    const size_t sizes[] = {1, 18, 55, 63, 64, 65, 127, 128, 129, 200, 300};
+    lengths[i] = sizes[i % 11];
+    messages[i] = data + (i*7) % (sizeof(data) - lengths[i] + 1);
+  }
+  
+  const blake2s_state *starts[] = {&keyed, &unkeyed};
+  for(unsigned int s = 0; s < 2; ++s) {
+    const blake2s_state *start = starts[s];
+    uint8_t expected[37*32], digests[38*32];
+    for(unsigned int i = 0; i < 37; ++i) {
+      blake2s_state state = *start;
+      blake2s_update(&state, messages[i], lengths[i]);
+      blake2s_final(&state, expected + i*start->digest_length);
+    }
+    
+    for(int level = BLAKE2S_SIMD_NONE; level <= blake2s_simd_level(); ++level) {
+      for(size_t count = 0; count <= 37; ++count) {
+        memset(digests, 0, sizeof(digests));
+        blake2s_many(start, messages, lengths, count, digests, level);
+        REQUIRE(memcmp(digests, expected, count*start->digest_length) == 0);
+        REQUIRE(digests[count*start->digest_length] == 0);
+      }
+    }
+  }
+  
+  SECTION("Through a keyring") {
+    keyring<4> keys;
+    keys.add(2, key, sizeof(key) - 1, 16);
+    const uint8_t command[] = "liberar:1700000000";
+    const uint8_t *commands[] = {command};
+    size_t command_lengths[] = {sizeof(command) - 1};
+    uint8_t tag[16], expected[16];
+    
+    REQUIRE_FALSE(keyring_sign_many(keys, 1, commands, command_lengths, 1, tag));
+    REQUIRE(keyring_sign_many(keys, 2, commands, command_lengths, 1, tag));
+    from_hex("7d6b81add258a999be2bd576e45aac9a", expected);
+    REQUIRE(memcmp(tag, expected, 16) == 0);
+  }
+  
+  SECTION("Framed and encoded as sign does, the messages are sign_command()'s") {
+    keyring<16> keys;
+    keys.add(0, key, sizeof(key) - 1, signature_tag_length);
+    keys.add(3, data, 32, signature_tag_length);
+    const char *lines[] = {"liberar:1700000000", "travar:0", "config:4294967295:3600", "status:1700000000:abc def",
+                           "chave:1700000000:-5", "abrir:1"};
+    const size_t count = sizeof(lines)/sizeof(lines[0]);
+    
+    const size_t key_ids[] = {0, 3};
+    for(size_t k = 0; k < 2; ++k) {
+      uint8_t framed[count][64], tags[count*signature_tag_length];
+      const uint8_t *framed_lines[count];
+      size_t framed_lengths[count];
+      for(size_t i = 0; i < count; ++i) {
+        framed_lengths[i] = frame_command(key_ids[k], (const uint8_t *) lines[i], strlen(lines[i]), framed[i]);
+        framed_lines[i] = framed[i];
+      }
+      
+      for(int level = BLAKE2S_SIMD_NONE; level <= blake2s_simd_level(); ++level) {
+        REQUIRE(keyring_sign_many(keys, key_ids[k], framed_lines, framed_lengths, count, tags, level));
+        for(int format = SIGNATURE_BASE64; format <= SIGNATURE_Z85; ++format) {
+          for(size_t i = 0; i < count; ++i) {
+            uint8_t expected[64], signature[signature_max_length];
+            size_t length = sign_command(keys, key_ids[k], (const uint8_t *) lines[i], strlen(lines[i]),
+                                         (signature_format) format, expected);
+            encode_signature((signature_format) format, tags + i*signature_tag_length, signature);
+            std::string message = std::string((char *) framed[i], framed_lengths[i]) + "$" +
+                                  std::string((char *) signature, signature_lengths[format]);
+            REQUIRE(message == std::string((char *) expected, length));
+          }
+        }
+      }
+    }
+  }
+}
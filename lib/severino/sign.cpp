@@ -0,0 +1,241 @@
+// Signs commands for the doors on the host. Build with `make sign`
+//
+// Reads `cmd:timestamp[:argument]` commands, one per line, from a file or stdin, and writes the ready to
+// publish `[id.]cmd:timestamp[:argument]$signature` messages in the same order. Each line is framed with
+// frame_command(), hashed with keyring_sign_many(), which runs blake2s_many(), and its tag written with
+// encode_signature(): byte for byte what sign_command(), the code the firmware checks them against, writes
+// (the blake2s_many() test in catch.cpp compares them). Lines are read in batches, each batch signed on all
+// cores and written out before the next one is read: the default batch suits files and pipes, `--batch 1`
+// answers each line as it arrives when run as a daemon behind a pipe. Each core hashes its lines 8 (AVX2) or
+// 4 (SSE4.1) at a time, `--scalar` one at a time. `--bench` measures signatures per second with 1 to all cores
+// instead
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "command.hpp"
+#include "signer.hpp"
+#include "blake2s_multi.hpp"
+
+typedef keyring<16> host_keyring;
+
+// Kernel for blake2s_many(), BLAKE2S_SIMD_NONE with --scalar
+static int simd_level = -1;
+
+// Lines framed and hashed together by sign_lines()
+static const size_t group_size = 64;
+
+// Command names the doors accept, from --commands
+static std::vector<std::string> known_commands;
+
+// Whether a line is a command the doors accept, checked with parse_command() as they check it: a known name, a
+// timestamp of up to 10 digits that fits in 32 bits and, if any, an argument of up to command_max_argument_length
+// printable characters. No key ID, --key-id adds it, and no '$'
+static bool valid_command(const std::string &line) {
+  const uint8_t *text = (const uint8_t *) line.data();
+  command_view command;
+  command.length = line.size();
+  if(line.empty() || line.find('$') != std::string::npos || !parse_command(text, command) || command.name_start != 0) {
+    return false;
+  }
+  for(const std::string &name : known_commands) {
+    if(command_name_is(text, command, name.c_str())) return true;
+  }
+  return false;
+}
+
+// Signs lines [begin, end) of a batch into output, skipping the ones valid_command() rejects. Returns how many
+// were skipped
+static size_t sign_lines(const host_keyring &keys, size_t key_id, signature_format format,
+                         const std::vector<std::string> &lines, size_t begin, size_t end, std::string &output) {
+  std::vector<uint8_t> framed;
+  const uint8_t *messages[group_size];
+  size_t lengths[group_size], offsets[group_size];
+  uint8_t tags[group_size*signature_tag_length], signature[signature_max_length];
+  size_t skipped = 0;
+  
+  output.clear();
+  for(size_t i = begin; i < end;) {
+    // Frames the next group of valid lines one after the other, then hashes them all at once
+    size_t count = 0;
+    framed.clear();
+    for(; i < end && count < group_size; ++i) {
+      const std::string &line = lines[i];
+      if(!valid_command(line)) {
+        ++skipped;
+        continue;
+      }
+      
+      offsets[count] = framed.size();
+      framed.resize(framed.size() + line.size() + 2);
+      lengths[count] = frame_command(key_id, (const uint8_t *) line.data(), line.size(), framed.data() + offsets[count]);
+      framed.resize(offsets[count] + lengths[count]);
+      ++count;
+    }
+    for(size_t j = 0; j < count; ++j) messages[j] = framed.data() + offsets[j];
+    keyring_sign_many(keys, key_id, messages, lengths, count, tags, simd_level);
+    
+    for(size_t j = 0; j < count; ++j) {
+      encode_signature(format, tags + j*signature_tag_length, signature);
+      output.append((const char *) messages[j], lengths[j]);
+      output += '$';
+      output.append((const char *) signature, signature_lengths[format]);
+      output += '\n';
+    }
+  }
+  return skipped;
+}
+
+// Signs a batch with up to threads threads, one contiguous share of the lines each, and concatenates their
+// outputs in order
+static size_t sign_batch(const host_keyring &keys, size_t key_id, signature_format format, unsigned int threads,
+                         const std::vector<std::string> &lines, std::string &output) {
+  // Short batches are not worth a thread per core
+  threads = std::max(1u, std::min(threads, (unsigned int) (lines.size()/1024)));
+  
+  std::vector<std::string> outputs(threads);
+  std::vector<size_t> skipped(threads);
+  std::vector<std::thread> workers;
+  for(unsigned int t = 0; t < threads; ++t) {
+    size_t begin = lines.size()*t/threads, end = lines.size()*(t + 1)/threads;
+    auto work = [&, t, begin, end] { skipped[t] = sign_lines(keys, key_id, format, lines, begin, end, outputs[t]); };
+    if(t + 1 < threads) workers.emplace_back(work);
+    else work();
+  }
+  for(std::thread &worker : workers) worker.join();
+  
+  size_t total_skipped = 0;
+  output.clear();
+  for(unsigned int t = 0; t < threads; ++t) {
+    output += outputs[t];
+    total_skipped += skipped[t];
+  }
+  return total_skipped;
+}
+
+// Signatures per second for a batch of typical commands, with 1, 2, 4... threads up to one per core
+static void benchmark(const host_keyring &keys, size_t key_id, signature_format format, unsigned int cores) {
+  const size_t count = 1 << 20;
+  std::vector<std::string> lines(count);
+  for(size_t i = 0; i < count; ++i) lines[i] = "liberar:" + std::to_string(1700000000 + i);
+  std::string output;
+  output.reserve(count*(signed_command_max_length(lines[0].size()) + 1));
+  
+  printf("%-10s %16s %16s\n", "threads", "signatures/s", "per thread");
+  for(unsigned int threads = 1;; threads = std::min(2*threads, cores)) {
+    double best = 0;
+    for(unsigned int run = 0; run < 5; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      sign_batch(keys, key_id, format, threads, lines, output);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      best = std::max(best, count/seconds);
+    }
+    printf("%-10u %16.0f %16.0f\n", threads, best, best/threads);
+    if(threads == cores) break;
+  }
+}
+
+static int hex_value(char c) {
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: sign (--key STRING | --key-hex HEX) [--key-id N] [--format base64|base64url|z85]\n"
+                  "            [--commands NAME,NAME...] [--threads N] [--batch LINES] [--scalar] [--bench] [FILE]\n");
+}
+
+int main(int argc, char **argv) {
+  std::vector<uint8_t> key;
+  size_t key_id = 0, batch = 65536;
+  signature_format format = SIGNATURE_BASE64;
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  bool bench = false;
+  const char *path = NULL;
+  std::string command_list = "liberar,travar,abrir,status,config,reboot,chave";
+  
+  for(int i = 1; i < argc; ++i) {
+    if(strcmp(argv[i], "--key") == 0 && i + 1 < argc) {
+      ++i;
+      key.assign(argv[i], argv[i] + strlen(argv[i]));
+    } else if(strcmp(argv[i], "--key-hex") == 0 && i + 1 < argc) {
+      const char *hex = argv[++i];
+      key.clear();
+      for(; hex[0] && hex[1] && hex_value(hex[0]) >= 0 && hex_value(hex[1]) >= 0; hex += 2) {
+        key.push_back(hex_value(hex[0]) << 4 | hex_value(hex[1]));
+      }
+      if(*hex) return usage(), 2;
+    } else if(strcmp(argv[i], "--key-id") == 0 && i + 1 < argc) key_id = strtoul(argv[++i], 0, 10);
+    else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      ++i;
+      if(strcmp(argv[i], "base64") == 0) format = SIGNATURE_BASE64;
+      else if(strcmp(argv[i], "base64url") == 0) format = SIGNATURE_BASE64URL;
+      else if(strcmp(argv[i], "z85") == 0) format = SIGNATURE_Z85;
+      else return usage(), 2;
+    } else if(strcmp(argv[i], "--commands") == 0 && i + 1 < argc) command_list = argv[++i];
+    else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(1ul, strtoul(argv[++i], 0, 10));
+    else if(strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batch = std::max(1ul, strtoul(argv[++i], 0, 10));
+    else if(strcmp(argv[i], "--scalar") == 0) simd_level = BLAKE2S_SIMD_NONE;
+    else if(strcmp(argv[i], "--bench") == 0) bench = true;
+    else if(argv[i][0] != '-' && !path) path = argv[i];
+    else return usage(), 2;
+  }
+  
+  for(size_t start = 0, comma; start <= command_list.size(); start = comma + 1) {
+    comma = command_list.find(',', start);
+    if(comma == std::string::npos) comma = command_list.size();
+    known_commands.push_back(command_list.substr(start, comma - start));
+  }
+  
+  host_keyring keys;
+  if(!keys.add(key_id, key.data(), key.size(), signature_tag_length) || key_id > 15) {
+    fprintf(stderr, "sign: a key of 1 to 32 bytes and a key ID of 0 to 15 are needed\n");
+    return usage(), 2;
+  }
+  
+  if(bench) {
+    benchmark(keys, key_id, format, threads);
+    return 0;
+  }
+  
+  FILE *input = path ? fopen(path, "r") : stdin;
+  if(!input) {
+    perror(path);
+    return 1;
+  }
+  
+  std::vector<std::string> lines;
+  std::string output;
+  char *line = NULL;
+  size_t capacity = 0, skipped = 0;
+  ssize_t length;
+  bool done = false;
+  
+  while(!done) {
+    lines.clear();
+    while(lines.size() < batch) {
+      if((length = getline(&line, &capacity, input)) < 0) {
+        done = true;
+        break;
+      }
+      while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) --length;
+      lines.emplace_back(line, length);
+    }
+    
+    skipped += sign_batch(keys, key_id, format, threads, lines, output);
+    fwrite(output.data(), 1, output.size(), stdout);
+    fflush(stdout);
+  }
+  
+  free(line);
+  if(path) fclose(input);
+  if(skipped) fprintf(stderr, "sign: skipped %zu lines that are not commands the doors accept\n", skipped);
+  return skipped ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * Acknowledgements the device publishes for every authenticated command, so the backend can match them to the
+ * commands it sent and measure their latency: `ack:<correlation>[.<index>]:<result>:<received>:<verified>:<done>`,
+ * where correlation is the first 8 bytes of the command's tag in hex, index the position (from 1) of the
+ * command in a batch, and the three device clock readings, in microseconds, are taken when the message arrived,
+ * when its signature was checked and when the command was carried out or refused. Forged messages get none,
+ * but a replayed authentic one does: whoever can publish to the broker can resend a captured message and get
+ * an ACK_REPLAYED or ACK_OUTSIDE_WINDOW acknowledgement back, as often as the prefilter's rate limit allows
+ */
+
+#ifndef SEVERINO_ACK_H_INCLUDED
+#define SEVERINO_ACK_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "command.hpp"
+
+/* ack_result:
+ *   Description:
+ *     What became of an authenticated command. The first four are command_registry's results, in its order:
+ *       ACK_DONE            - carried out
+ *       ACK_FAILED          - refused by its handler
+ *       ACK_BAD_ARGUMENT    - the argument does not fit the command's schema
+ *       ACK_UNKNOWN_COMMAND - no such command
+ *       ACK_OUTSIDE_WINDOW  - timestamp too far from the device's clock
+ *       ACK_REPLAYED        - already accepted once
+ *       ACK_REPLAY_FULL     - the replay guard had no room to remember it
+ *       ACK_CLOCK_NOT_SET   - the device's clock is not synchronized yet
+ *       ACK_BEFORE_BOOT     - timestamped before the device booted
+ */
+enum ack_result {
+  ACK_DONE,
+  ACK_FAILED,
+  ACK_BAD_ARGUMENT,
+  ACK_UNKNOWN_COMMAND,
+  ACK_OUTSIDE_WINDOW,
+  ACK_REPLAYED,
+  ACK_REPLAY_FULL,
+  ACK_CLOCK_NOT_SET,
+  ACK_BEFORE_BOOT,
+  ACK_RESULTS
+};
+
+static const size_t ack_correlation_length = 8;
+
+// Longest acknowledgement: "ack:", correlation, "." and an index of up to 3 digits, and four fields of up to
+// 10 digits
+static const size_t ack_max_length = 4 + 2*ack_correlation_length + 4 + 4*(1 + 10);
+
+struct command_ack {
+  uint8_t correlation[ack_correlation_length];  // First bytes of the command's tag
+  uint8_t index;                                // Position in its batch, from 1, 0 for a single command
+  uint8_t result;                               // ack_result
+  uint32_t received;                            // Device clock, in microseconds
+  uint32_t verified;
+  uint32_t done;
+};
+
+// Writes a number in decimal, returns the number of digits
+inline size_t write_decimal(uint32_t value, char output[]) {
+  char digits[10];
+  size_t count = 0;
+  do {
+    digits[count++] = '0' + value%10;
+    value /= 10;
+  } while(value);
+  for(size_t i = 0; i < count; ++i) output[i] = digits[count - 1 - i];
+  return count;
+}
+
+/* format_ack:
+ *   Description:
+ *     Writes an acknowledgement as published
+ *   Parameters:
+ *     ack - The acknowledgement
+ *     output - At least ack_max_length + 1 bytes. Null-terminated
+ *   Returns:
+ *     Length written, without the terminator
+ */
+inline size_t format_ack(const command_ack &ack, char output[]) {
+  size_t position = 4;
+  memcpy(output, "ack:", 4);
+  for(size_t i = 0; i < ack_correlation_length; ++i) {
+    output[position++] = "0123456789abcdef"[ack.correlation[i] >> 4];
+    output[position++] = "0123456789abcdef"[ack.correlation[i] & 15];
+  }
+  if(ack.index) {
+    output[position++] = '.';
+    position += write_decimal(ack.index, output + position);
+  }
+  const uint32_t fields[] = {ack.result, ack.received, ack.verified, ack.done};
+  for(size_t i = 0; i < 4; ++i) {
+    output[position++] = ':';
+    position += write_decimal(fields[i], output + position);
+  }
+  output[position] = '\0';
+  return position;
+}
+
+/* parse_ack:
+ *   Description:
+ *     Reads an acknowledgement format_ack() wrote, for the backend
+ *   Parameters:
+ *     text - The acknowledgement, length bytes
+ *     ack - Set to it, if it is well formed
+ *   Returns:
+ *     Whether it is well formed
+ */
+inline bool parse_ack(const char text[], size_t length, command_ack &ack) {
+  const char *end = text + length, *c = text + 4;
+  if(length < 4 + 2*ack_correlation_length || memcmp(text, "ack:", 4) != 0) return false;
+  
+  for(size_t i = 0; i < 2*ack_correlation_length; ++i, ++c) {
+    int digit = *c >= '0' && *c <= '9' ? *c - '0' : *c >= 'a' && *c <= 'f' ? *c - 'a' + 10 : -1;
+    if(digit < 0) return false;
+    if(i%2 == 0) ack.correlation[i/2] = (uint8_t) (digit << 4);
+    else ack.correlation[i/2] |= (uint8_t) digit;
+  }
+  
+  // Index, if any, then the four numbers, each up to the next separator
+  uint32_t values[5];
+  size_t count = 0;
+  bool indexed = c < end && *c == '.';
+  while(c < end && count < 5) {
+    if(*c != (count == 0 && indexed ? '.' : ':')) return false;
+    const char *start = ++c;
+    for(; c < end && *c >= '0' && *c <= '9'; ++c);
+    if(!parse_uint32((const uint8_t *) start, c - start, values[count++])) return false;
+  }
+  if(c != end || count != (indexed ? 5u : 4u)) return false;
+  
+  const uint32_t *v = values;
+  ack.index = 0;
+  if(indexed) {
+    if(*v == 0 || *v > 255) return false;
+    ack.index = (uint8_t) *v++;
+  }
+  if(v[0] >= ACK_RESULTS) return false;
+  ack.result = (uint8_t) v[0];
+  ack.received = v[1];
+  ack.verified = v[2];
+  ack.done = v[3];
+  return true;
+}
+
+#endif // ifndef
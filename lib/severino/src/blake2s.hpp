@@ -0,0 +1,197 @@
+/**
+ * BLAKE2s (RFC 7693), keyed or not, with digests of 1 to 32 bytes. Unlike the BLAKE2s class of the Crypto
+ * library, the key block can be compressed ahead of time: a keyed state is set up once and copied for each
+ * message, so hashing a short message costs one compression instead of two
+ */
+
+#ifndef SEVERINO_BLAKE2S_H_INCLUDED
+#define SEVERINO_BLAKE2S_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* blake2s_state:
+ *   Description:
+ *     State of a hash in progress. A plain struct, copying it forks the hash. The byte counter is 32 bits, so
+ *     messages (key block included) are limited to 4 GiB
+ */
+struct blake2s_state {
+  uint32_t h[8];
+  uint32_t counter;        // Bytes compressed so far
+  uint8_t block[64];       // Bytes not compressed yet, the last block is compressed by blake2s_final()
+  uint8_t block_length;
+  uint8_t digest_length;
+};
+
+static const uint32_t blake2s_iv[8] = {
+  0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+  { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+  {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+  {11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4},
+  { 7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8},
+  { 9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13},
+  { 2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9},
+  {12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11},
+  {13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10},
+  { 6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5},
+  {10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0}
+};
+
+inline uint32_t blake2s_rotr(uint32_t x, unsigned int n) {
+  return x >> n | x << (32 - n);
+}
+
+inline uint32_t blake2s_load32(const uint8_t p[]) {
+  return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+#define BLAKE2S_G(a, b, c, d, x, y)              \
+  do {                                          \
+    v[a] = v[a] + v[b] + (x);                   \
+    v[d] = blake2s_rotr(v[d] ^ v[a], 16);       \
+    v[c] = v[c] + v[d];                         \
+    v[b] = blake2s_rotr(v[b] ^ v[c], 12);       \
+    v[a] = v[a] + v[b] + (y);                   \
+    v[d] = blake2s_rotr(v[d] ^ v[a], 8);        \
+    v[c] = v[c] + v[d];                         \
+    v[b] = blake2s_rotr(v[b] ^ v[c], 7);        \
+  } while(0)
+
+/* blake2s_compress:
+ *   Description:
+ *     Mixes one 64-byte block into h. counter is the number of bytes hashed including this block, last is set
+ *     for the final block
+ */
+inline void blake2s_compress(uint32_t h[8], const uint8_t block[64], uint32_t counter, bool last) {
+  uint32_t m[16], v[16];
+  
+  for(unsigned int i = 0; i < 16; ++i) m[i] = blake2s_load32(block + 4*i);
+  for(unsigned int i = 0; i < 8; ++i) {
+    v[i] = h[i];
+    v[i + 8] = blake2s_iv[i];
+  }
+  v[12] ^= counter;
+  if(last) v[14] = ~v[14];
+  
+  for(unsigned int round = 0; round < 10; ++round) {
+    const uint8_t *s = blake2s_sigma[round];
+    
+    BLAKE2S_G(0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);
+    BLAKE2S_G(1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);
+    BLAKE2S_G(2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);
+    BLAKE2S_G(3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);
+    BLAKE2S_G(0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);
+    BLAKE2S_G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+    BLAKE2S_G(2, 7,  8, 13, m[s[12]], m[s[13]]);
+    BLAKE2S_G(3, 4,  9, 14, m[s[14]], m[s[15]]);
+  }
+  
+  for(unsigned int i = 0; i < 8; ++i) h[i] ^= v[i] ^ v[i + 8];
+}
+
+#undef BLAKE2S_G
+
+/* blake2s_init:
+ *   Description:
+ *     Starts a hash. With a key, the key padded with zeros to 64 bytes is the first block
+ *   Parameters:
+ *     state - State to set up
+ *     digest_length - Length of the digest in bytes, 1 to 32
+ *     key - Pointer to the key, may be null when key_length is 0
+ *     key_length - Length of the key in bytes, 0 to 32
+ */
+inline void blake2s_init(blake2s_state *state, size_t digest_length, const uint8_t key[], size_t key_length) {
+  for(unsigned int i = 0; i < 8; ++i) state->h[i] = blake2s_iv[i];
+  state->h[0] ^= 0x01010000 ^ (uint32_t) key_length << 8 ^ (uint32_t) digest_length;
+  state->counter = 0;
+  state->block_length = 0;
+  state->digest_length = digest_length;
+  
+  if(key_length > 0) {
+    memset(state->block, 0, 64);
+    memcpy(state->block, key, key_length);
+    state->block_length = 64;
+  }
+}
+
+/* blake2s_precompute_key:
+ *   Description:
+ *     Compresses the key block of a state fresh from blake2s_init(), which would otherwise wait for the first
+ *     message byte (the last block of a hash is compressed differently, so BLAKE2s holds on to a full block
+ *     until more data arrives). Copies of the result then start right at the message. A precomputed state
+ *     must be given at least one message byte before blake2s_final(): the digest of the key alone needs the
+ *     key block compressed as the last block. Does nothing on a state without key
+ *   Parameters:
+ *     state - Keyed state from blake2s_init()
+ */
+inline void blake2s_precompute_key(blake2s_state *state) {
+  if(state->counter == 0 && state->block_length == 64) {
+    state->counter = 64;
+    blake2s_compress(state->h, state->block, state->counter, false);
+    state->block_length = 0;
+  }
+}
+
+/* blake2s_update:
+ *   Description:
+ *     Hashes length more bytes of the message
+ *   Parameters:
+ *     state - State from blake2s_init()
+ *     data - Pointer to the bytes
+ *     length - Number of bytes
+ */
+inline void blake2s_update(blake2s_state *state, const uint8_t data[], size_t length) {
+  while(length > 0) {
+    // Only compress a full block once more data follows it
+    if(state->block_length == 64) {
+      state->counter += 64;
+      blake2s_compress(state->h, state->block, state->counter, false);
+      state->block_length = 0;
+    }
+    
+    size_t chunk = 64 - state->block_length;
+    if(chunk > length) chunk = length;
+    
+    memcpy(state->block + state->block_length, data, chunk);
+    state->block_length += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+/* blake2s_final:
+ *   Description:
+ *     Compresses the last block and writes the digest. The state must be set up again before reuse
+ *   Parameters:
+ *     state - State from blake2s_init()
+ *     digest - Pointer to output, digest_length bytes are written
+ */
+inline void blake2s_final(blake2s_state *state, uint8_t digest[]) {
+  state->counter += state->block_length;
+  memset(state->block + state->block_length, 0, 64 - state->block_length);
+  blake2s_compress(state->h, state->block, state->counter, true);
+  
+  for(unsigned int i = 0; i < state->digest_length; ++i) digest[i] = state->h[i/4] >> 8*(i % 4);
+}
+
+/* blake2s:
+ *   Description:
+ *     Hashes a whole message in one call
+ *   Parameters:
+ *     digest - Pointer to output, digest_length bytes are written
+ *     digest_length - Length of the digest in bytes, 1 to 32
+ *     data, length - The message
+ *     key, key_length - The key, 0 to 32 bytes
+ */
+inline void blake2s(uint8_t digest[], size_t digest_length, const uint8_t data[], size_t length, const uint8_t key[], size_t key_length) {
+  blake2s_state state;
+  blake2s_init(&state, digest_length, key, key_length);
+  blake2s_update(&state, data, length);
+  blake2s_final(&state, digest);
+}
+
+#endif // ifndef
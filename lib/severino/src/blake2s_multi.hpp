@@ -0,0 +1,251 @@
+/**
+ * Multi-buffer BLAKE2s for host tools: many independent messages hashed from the same starting state (the
+ * keyed state of a key, usually) at once, one message per 32-bit SIMD lane. Gives the same digests as copying
+ * the state and hashing each message with blake2s_update() and blake2s_final()
+ */
+
+#ifndef SEVERINO_BLAKE2S_MULTI_H_INCLUDED
+#define SEVERINO_BLAKE2S_MULTI_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "blake2s.hpp"
+#include "keyring.hpp"
+
+/* BLAKE2S_HAVE_X86_SIMD:
+ *   Description:
+ *     Defined on x86 with GCC or Clang unless BLAKE2S_NO_SIMD is defined. The 4-way (SSE4.1) and 8-way (AVX2)
+ *     kernels are then built with target attributes and picked at run time, the rest of the program needs
+ *     no special flags
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && !defined(BLAKE2S_NO_SIMD)
+  #define BLAKE2S_HAVE_X86_SIMD 1
+  #include <immintrin.h>
+#endif
+
+#define BLAKE2S_SIMD_NONE 0
+#define BLAKE2S_SIMD_SSE41 1
+#define BLAKE2S_SIMD_AVX2 2
+
+/* blake2s_simd_level:
+ *   Description:
+ *     Detects (once) the widest kernel supported by the running CPU
+ *   Returns:
+ *     BLAKE2S_SIMD_AVX2, BLAKE2S_SIMD_SSE41 or BLAKE2S_SIMD_NONE
+ */
+inline int blake2s_simd_level() {
+#ifdef BLAKE2S_HAVE_X86_SIMD
+  static int level = -1;
+  
+  if(level < 0) {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) level = BLAKE2S_SIMD_AVX2;
+    else if(__builtin_cpu_supports("sse4.1")) level = BLAKE2S_SIMD_SSE41;
+    else level = BLAKE2S_SIMD_NONE;
+  }
+  
+  return level;
+#else
+  return BLAKE2S_SIMD_NONE;
+#endif
+}
+
+#ifdef BLAKE2S_HAVE_X86_SIMD
+
+// G on whole vectors, with the rotations given as macros: by 16 and 8 are byte shuffles, by 12 and 7 shifts
+#define BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, a, b, c, d, x, y)  \
+  do {                                                                        \
+    v[a] = ADD(ADD(v[a], v[b]), x);                                           \
+    v[d] = ROT16(XOR(v[d], v[a]));                                            \
+    v[c] = ADD(v[c], v[d]);                                                   \
+    v[b] = ROT12(XOR(v[b], v[c]));                                            \
+    v[a] = ADD(ADD(v[a], v[b]), y);                                           \
+    v[d] = ROT8(XOR(v[d], v[a]));                                             \
+    v[c] = ADD(v[c], v[d]);                                                   \
+    v[b] = ROT7(XOR(v[b], v[c]));                                             \
+  } while(0)
+
+#define BLAKE2S_MULTI_ROUNDS(ADD, XOR, ROT16, ROT12, ROT8, ROT7)                                         \
+  for(unsigned int round = 0; round < 10; ++round) {                                                      \
+    const uint8_t *s = blake2s_sigma[round];                                                              \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);                \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);                \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);                \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);                \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);                \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 1, 6, 11, 12, m[s[10]], m[s[11]]);                \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 2, 7,  8, 13, m[s[12]], m[s[13]]);                \
+    BLAKE2S_MULTI_G(ADD, XOR, ROT16, ROT12, ROT8, ROT7, 3, 4,  9, 14, m[s[14]], m[s[15]]);                \
+  }
+
+#define BLAKE2S_SSE_ROT16(x) _mm_shuffle_epi8(x, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13))
+#define BLAKE2S_SSE_ROT12(x) _mm_or_si128(_mm_srli_epi32(x, 12), _mm_slli_epi32(x, 20))
+#define BLAKE2S_SSE_ROT8(x) _mm_shuffle_epi8(x, _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12))
+#define BLAKE2S_SSE_ROT7(x) _mm_or_si128(_mm_srli_epi32(x, 7), _mm_slli_epi32(x, 25))
+
+/* blake2s_compress_4way:
+ *   Description:
+ *     blake2s_compress() of 4 lanes, h[i][lane] and m[i][lane] being word i of each lane. counter is per lane,
+ *     last and active are all ones or zero per lane; inactive lanes keep their h
+ */
+__attribute__((target("sse4.1")))
+inline void blake2s_compress_4way(uint32_t h[8][4], const uint32_t words[16][4], const uint32_t counter[4],
+                                  const uint32_t last[4], const uint32_t active[4]) {
+  __m128i m[16], v[16], old[8];
+  
+  for(unsigned int i = 0; i < 16; ++i) m[i] = _mm_loadu_si128((const __m128i *) words[i]);
+  for(unsigned int i = 0; i < 8; ++i) {
+    v[i] = old[i] = _mm_loadu_si128((const __m128i *) h[i]);
+    v[i + 8] = _mm_set1_epi32(blake2s_iv[i]);
+  }
+  v[12] = _mm_xor_si128(v[12], _mm_loadu_si128((const __m128i *) counter));
+  v[14] = _mm_xor_si128(v[14], _mm_loadu_si128((const __m128i *) last));
+  
+  BLAKE2S_MULTI_ROUNDS(_mm_add_epi32, _mm_xor_si128, BLAKE2S_SSE_ROT16, BLAKE2S_SSE_ROT12, BLAKE2S_SSE_ROT8, BLAKE2S_SSE_ROT7)
+  
+  __m128i mask = _mm_loadu_si128((const __m128i *) active);
+  for(unsigned int i = 0; i < 8; ++i) {
+    __m128i mixed = _mm_xor_si128(old[i], _mm_xor_si128(v[i], v[i + 8]));
+    _mm_storeu_si128((__m128i *) h[i], _mm_blendv_epi8(old[i], mixed, mask));
+  }
+}
+
+#define BLAKE2S_AVX_ROT16(x) _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, \
+                                                                     2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13))
+#define BLAKE2S_AVX_ROT12(x) _mm256_or_si256(_mm256_srli_epi32(x, 12), _mm256_slli_epi32(x, 20))
+#define BLAKE2S_AVX_ROT8(x) _mm256_shuffle_epi8(x, _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12, \
+                                                                    1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12))
+#define BLAKE2S_AVX_ROT7(x) _mm256_or_si256(_mm256_srli_epi32(x, 7), _mm256_slli_epi32(x, 25))
+
+// blake2s_compress_4way() on 8 lanes
+__attribute__((target("avx2")))
+inline void blake2s_compress_8way(uint32_t h[8][8], const uint32_t words[16][8], const uint32_t counter[8],
+                                  const uint32_t last[8], const uint32_t active[8]) {
+  __m256i m[16], v[16], old[8];
+  
+  for(unsigned int i = 0; i < 16; ++i) m[i] = _mm256_loadu_si256((const __m256i *) words[i]);
+  for(unsigned int i = 0; i < 8; ++i) {
+    v[i] = old[i] = _mm256_loadu_si256((const __m256i *) h[i]);
+    v[i + 8] = _mm256_set1_epi32(blake2s_iv[i]);
+  }
+  v[12] = _mm256_xor_si256(v[12], _mm256_loadu_si256((const __m256i *) counter));
+  v[14] = _mm256_xor_si256(v[14], _mm256_loadu_si256((const __m256i *) last));
+  
+  BLAKE2S_MULTI_ROUNDS(_mm256_add_epi32, _mm256_xor_si256, BLAKE2S_AVX_ROT16, BLAKE2S_AVX_ROT12, BLAKE2S_AVX_ROT8, BLAKE2S_AVX_ROT7)
+  
+  __m256i mask = _mm256_loadu_si256((const __m256i *) active);
+  for(unsigned int i = 0; i < 8; ++i) {
+    __m256i mixed = _mm256_xor_si256(old[i], _mm256_xor_si256(v[i], v[i + 8]));
+    _mm256_storeu_si256((__m256i *) h[i], _mm256_blendv_epi8(old[i], mixed, mask));
+  }
+  _mm256_zeroupper();
+}
+
+#undef BLAKE2S_MULTI_G
+#undef BLAKE2S_MULTI_ROUNDS
+#undef BLAKE2S_SSE_ROT16
+#undef BLAKE2S_SSE_ROT12
+#undef BLAKE2S_SSE_ROT8
+#undef BLAKE2S_SSE_ROT7
+#undef BLAKE2S_AVX_ROT16
+#undef BLAKE2S_AVX_ROT12
+#undef BLAKE2S_AVX_ROT8
+#undef BLAKE2S_AVX_ROT7
+
+/* blake2s_many_lanes<Lanes>:
+ *   Description:
+ *     Hashes the messages Lanes at a time with a Lanes-way compress function. Lanes run in step, block by
+ *     block: a lane whose message has fewer blocks than the longest in its group sits the remaining steps out
+ */
+template <size_t Lanes, typename Compress>
+inline void blake2s_many_lanes(const blake2s_state *start, const uint8_t *const messages[], const size_t lengths[],
+                               size_t count, uint8_t digests[], Compress compress) {
+  for(size_t first = 0; first < count; first += Lanes) {
+    size_t lanes = count - first < Lanes ? count - first : Lanes;
+    uint32_t h[8][Lanes], words[16][Lanes], counter[Lanes], last[Lanes], active[Lanes];
+    size_t blocks[Lanes], most = 0;
+    
+    for(size_t lane = 0; lane < Lanes; ++lane) {
+      for(unsigned int i = 0; i < 8; ++i) h[i][lane] = start->h[i];
+      blocks[lane] = lane < lanes ? (lengths[first + lane] + 63)/64 : 0;
+      if(lane < lanes && blocks[lane] == 0) blocks[lane] = 1;
+      if(blocks[lane] > most) most = blocks[lane];
+    }
+    
+    for(size_t step = 0; step < most; ++step) {
+      for(size_t lane = 0; lane < Lanes; ++lane) {
+        uint8_t block[64];
+        const uint8_t *source = block;
+        size_t offset = 64*step, chunk = 0;
+        
+        active[lane] = step < blocks[lane] ? 0xFFFFFFFF : 0;
+        if(active[lane]) chunk = lengths[first + lane] - offset < 64 ? lengths[first + lane] - offset : 64;
+        
+        // Full blocks are read in place, the last one is copied and padded with zeros
+        if(chunk == 64) source = messages[first + lane] + offset;
+        else {
+          if(chunk > 0) memcpy(block, messages[first + lane] + offset, chunk);
+          memset(block + chunk, 0, 64 - chunk);
+        }
+        for(unsigned int i = 0; i < 16; ++i) words[i][lane] = blake2s_load32(source + 4*i);
+        counter[lane] = start->counter + (uint32_t) (offset + chunk);
+        last[lane] = step + 1 == blocks[lane] ? 0xFFFFFFFF : 0;
+      }
+      compress(h, words, counter, last, active);
+    }
+    
+    for(size_t lane = 0; lane < lanes; ++lane) {
+      uint8_t *digest = digests + (first + lane)*start->digest_length;
+      for(unsigned int i = 0; i < start->digest_length; ++i) digest[i] = h[i/4][lane] >> 8*(i % 4);
+    }
+  }
+}
+
+#endif // BLAKE2S_HAVE_X86_SIMD
+
+/* blake2s_many:
+ *   Description:
+ *     Hashes count messages, each continuing from a copy of start, with the widest kernel the CPU (or level)
+ *     allows. Same digests as blake2s_update() and blake2s_final() on a copy of start per message
+ *   Parameters:
+ *     start - Starting state, such as a key's state after blake2s_precompute_key(). The SIMD kernels need it
+ *             to have no bytes waiting in its block (any state does, fresh from blake2s_init() without key or
+ *             precomputed with one); others are hashed one at a time
+ *     messages, lengths - The messages, at least 1 byte each if start is a precomputed keyed state
+ *     count - Number of messages
+ *     digests - Where to write the digests, start->digest_length bytes each, one after the other
+ *     level - BLAKE2S_SIMD_NONE, BLAKE2S_SIMD_SSE41 or BLAKE2S_SIMD_AVX2 to use at most that kernel, for
+ *             comparisons. Defaults to blake2s_simd_level()
+ */
+inline void blake2s_many(const blake2s_state *start, const uint8_t *const messages[], const size_t lengths[],
+                         size_t count, uint8_t digests[], int level = -1) {
+  if(level < 0 || level > blake2s_simd_level()) level = blake2s_simd_level();
+
+#ifdef BLAKE2S_HAVE_X86_SIMD
+  if(start->block_length == 0 && level == BLAKE2S_SIMD_AVX2) return blake2s_many_lanes<8>(start, messages, lengths, count, digests, blake2s_compress_8way);
+  if(start->block_length == 0 && level == BLAKE2S_SIMD_SSE41) return blake2s_many_lanes<4>(start, messages, lengths, count, digests, blake2s_compress_4way);
+#endif
+  
+  for(size_t i = 0; i < count; ++i) {
+    blake2s_state state = *start;
+    blake2s_update(&state, messages[i], lengths[i]);
+    blake2s_final(&state, digests + i*start->digest_length);
+  }
+}
+
+/* keyring_sign_many:
+ *   Description:
+ *     keyring::sign() of many messages with the same key, through blake2s_many()
+ *   Returns:
+ *     Whether the key is active, if not digests is left untouched
+ */
+template <size_t Keys>
+bool keyring_sign_many(const keyring<Keys> &keys, size_t id, const uint8_t *const messages[], const size_t lengths[],
+                       size_t count, uint8_t tags[], int level = -1) {
+  if(!keys.contains(id)) return false;
+  blake2s_many(&keys.states[id], messages, lengths, count, tags, level);
+  return true;
+}
+
+#endif // ifndef
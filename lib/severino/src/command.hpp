@@ -0,0 +1,131 @@
+/**
+ * Parser of text commands, `[id.]name:timestamp[:argument]<separator>signature`, that works in place: the
+ * result is a set of offsets and lengths into the received buffer, nothing is copied or allocated. Binary
+ * frames (frame.hpp) are described by the same command_view
+ */
+
+#ifndef SEVERINO_COMMAND_H_INCLUDED
+#define SEVERINO_COMMAND_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static const size_t command_max_timestamp_digits = 10;
+static const size_t command_max_argument_length = 80;
+
+/* command_view:
+ *   Description:
+ *     Where the parts of a command are in the buffer it was parsed from, which must outlive it
+ */
+struct command_view {
+  uint8_t key_id;           // One hex digit, 0 if left out
+  uint8_t opcode;           // Binary frames only (see frame.hpp), in place of the name
+  size_t name_start;        // After the key ID
+  size_t name_length;       // Command name, before ':'
+  uint32_t timestamp;
+  size_t argument_start;    // After the timestamp and its ':', or the separator if there is no argument
+  size_t argument_length;
+  size_t length;            // Everything before the separator, the signed part
+  size_t signature_length;  // After the separator
+};
+
+/* parse_uint32:
+ *   Description:
+ *     Parses a decimal number made of digits only, rejecting an empty one and one over 2^32 - 1
+ *   Parameters:
+ *     digits - The digits, length of them
+ *     value - Set to the number, if valid
+ *   Returns:
+ *     Whether it was valid
+ */
+inline bool parse_uint32(const uint8_t digits[], size_t length, uint32_t &value) {
+  uint32_t result = 0;
+  
+  if(length == 0) return false;
+  for(size_t i = 0; i < length; ++i) {
+    uint32_t digit = (uint32_t) digits[i] - '0';
+    if(digit > 9 || result > (0xFFFFFFFF - digit)/10) return false;
+    result = result*10 + digit;
+  }
+  
+  value = result;
+  return true;
+}
+
+/* split_command:
+ *   Description:
+ *     Finds the separator, which must be within the first max_length + 1 bytes, and sets command.length and
+ *     command.signature_length. Bytes past that point are not looked at
+ *   Parameters:
+ *     payload - The received message, length bytes, not null-terminated
+ *     separator - Character between the command and its signature
+ *     max_length - Longest command accepted
+ *     command - Where the parts are recorded
+ *   Returns:
+ *     Whether the separator was found
+ */
+inline bool split_command(const uint8_t payload[], size_t length, char separator, size_t max_length, command_view &command) {
+  size_t limit = length < max_length + 1 ? length : max_length + 1;
+  const uint8_t *end = (const uint8_t *) memchr(payload, separator, limit);
+  if(end == NULL) return false;
+  
+  command.length = end - payload;
+  command.signature_length = length - command.length - 1;
+  return true;
+}
+
+/* parse_command:
+ *   Description:
+ *     Parses the command part of a message split_command() split: key ID, name, timestamp and argument
+ *   Parameters:
+ *     payload - The received message
+ *     command - From split_command(), the other fields are set if the command is well formed
+ *   Returns:
+ *     Whether it is well formed: a key ID, if any, of one lowercase hex digit and '.', a name of at least
+ *     one character, ':', a timestamp of 1 to 10 digits that fits in 32 bits and, if any, ':' and an argument
+ *     of up to command_max_argument_length printable ASCII characters
+ */
+inline bool parse_command(const uint8_t payload[], command_view &command) {
+  const uint8_t *end = payload + command.length;
+  
+  command.key_id = 0;
+  command.name_start = 0;
+  if(command.length >= 2 && payload[1] == '.') {
+    if(payload[0] >= '0' && payload[0] <= '9') command.key_id = payload[0] - '0';
+    else if(payload[0] >= 'a' && payload[0] <= 'f') command.key_id = payload[0] - 'a' + 10;
+    else return false;
+    command.name_start = 2;
+  }
+  
+  const uint8_t *name = payload + command.name_start;
+  const uint8_t *colon = (const uint8_t *) memchr(name, ':', end - name);
+  if(colon == NULL || colon == name) return false;
+  command.name_length = colon - name;
+  
+  const uint8_t *c = colon + 1;
+  for(; c < end && *c >= '0' && *c <= '9'; ++c);
+  size_t digits = c - colon - 1;
+  if(digits > command_max_timestamp_digits || !parse_uint32(colon + 1, digits, command.timestamp)) return false;
+  
+  command.argument_start = c - payload;
+  command.argument_length = 0;
+  if(c < end) {
+    if(*c != ':') return false;
+    command.argument_start = ++c - payload;
+    command.argument_length = end - c;
+    if(command.argument_length > command_max_argument_length) return false;
+    for(; c < end; ++c) {
+      if(*c < ' ' || *c > '~') return false;
+    }
+  }
+  
+  return true;
+}
+
+// Whether a parsed command has a given name
+inline bool command_name_is(const uint8_t payload[], const command_view &command, const char *name) {
+  return strlen(name) == command.name_length && memcmp(payload + command.name_start, name, command.name_length) == 0;
+}
+
+#endif // ifndef
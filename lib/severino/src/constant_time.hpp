@@ -0,0 +1,39 @@
+/**
+ * Comparisons whose running time does not depend on the data compared, for checking MAC tags
+ */
+
+#ifndef SEVERINO_CONSTANT_TIME_H_INCLUDED
+#define SEVERINO_CONSTANT_TIME_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* constant_time_equal:
+ *   Description:
+ *     Compares two byte arrays without exiting early. Every byte is read and the differences are ORed
+ *     together, so the time taken reveals nothing about where (or whether) the arrays differ. Use it to
+ *     check a received MAC tag against the computed one, an early-exit compare lets an attacker find the tag
+ *     one byte at a time
+ *   Parameters:
+ *     a, b - Pointers to the arrays
+ *     length - Number of bytes to compare
+ *   Returns:
+ *     true if the arrays are equal
+ */
+inline bool constant_time_equal(const uint8_t a[], const uint8_t b[], size_t length) {
+  uint8_t difference = 0;
+  
+  for(size_t i = 0; i < length; ++i) {
+    difference |= a[i] ^ b[i];
+    
+    // Hides the running value from the optimizer, so it cannot stop early once a difference is seen
+#if defined(__GNUC__)
+    asm("" : "+r"(difference));
+#endif
+  }
+  
+  // 1 when difference is 0, without a data-dependent branch
+  return ((uint32_t) difference - 1) >> 8 & 1;
+}
+
+#endif // ifndef
@@ -0,0 +1,238 @@
+/**
+ * Binary command frames, the compact alternative to the text `[id.]name:timestamp[:argument]$signature`
+ * published on a topic of their own. Fixed layout, so nothing is scanned for or decoded:
+ *
+ *   offset  size  field
+ *   0       1     version, frame_version
+ *   1       1     opcode, the command's index in the device's command table
+ *   2       1     key ID, 0 to 15
+ *   3       4     timestamp, big-endian
+ *   7       1     argument length, 0 to command_max_argument_length
+ *   8       n     argument, printable ASCII as in text commands
+ *   8 + n   16    tag, raw, over everything before it
+ *
+ * A `liberar` takes 24 bytes against 43 as text. The version byte is not printable, so the signed part of a
+ * frame can never be taken for a text command or the other way around.
+ *
+ * Batches carry up to frame_max_batch commands, run in order, under a single tag and timestamp, so a bulk
+ * operation costs one MAC and one replay check:
+ *
+ *   offset  size  field
+ *   0       1     version, frame_batch_version
+ *   1       1     number of commands, 1 to frame_max_batch
+ *   2       1     key ID, 0 to 15
+ *   3       4     timestamp, big-endian
+ *   7             for each command: opcode (1 byte), argument length (1 byte) and argument
+ *   ...     16    tag, raw, over everything before it
+ *
+ * at most frame_batch_max_length bytes in all, which leaves room for the topic in PubSubClient's default
+ * 256-byte packet
+ */
+
+#ifndef SEVERINO_FRAME_H_INCLUDED
+#define SEVERINO_FRAME_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "command.hpp"
+#include "keyring.hpp"
+
+static const uint8_t frame_version = 1;
+static const size_t frame_header_length = 8;
+static const size_t frame_tag_length = 16;
+static const size_t frame_min_length = frame_header_length + frame_tag_length;
+static const size_t frame_max_length = frame_min_length + command_max_argument_length;
+
+static const uint8_t frame_batch_version = 2;
+static const size_t frame_batch_header_length = 7;
+static const size_t frame_max_batch = 16;
+static const size_t frame_batch_max_length = 192;
+
+/* parse_frame:
+ *   Description:
+ *     Checks the layout of a frame whose length is between frame_min_length and frame_max_length, and records
+ *     where its parts are as parse_command() does for text: the signed part is the first command.length
+ *     bytes and the raw tag follows it. There is no name, the opcode stands for it
+ *   Parameters:
+ *     payload - The received frame, length bytes
+ *     command - Set to where its parts are, if it is well formed
+ *   Returns:
+ *     Whether it is well formed: known version, key ID of one hex digit, argument length matching the frame
+ *     length and printable argument
+ */
+inline bool parse_frame(const uint8_t payload[], size_t length, command_view &command) {
+  if(payload[0] != frame_version || payload[2] > 15) return false;
+  if(frame_min_length + payload[7] != length) return false;
+  
+  command.opcode = payload[1];
+  command.key_id = payload[2];
+  command.timestamp = (uint32_t) payload[3] << 24 | (uint32_t) payload[4] << 16 | (uint32_t) payload[5] << 8 | payload[6];
+  command.name_start = 1;
+  command.name_length = 0;
+  command.argument_start = frame_header_length;
+  command.argument_length = payload[7];
+  command.length = frame_header_length + payload[7];
+  command.signature_length = frame_tag_length;
+  for(size_t i = frame_header_length; i < command.length; ++i) {
+    if(payload[i] < ' ' || payload[i] > '~') return false;
+  }
+  return true;
+}
+
+/* sign_frame:
+ *   Description:
+ *     Writes a signed frame
+ *   Parameters:
+ *     keys - Keys to sign with, added with a digest length of frame_tag_length
+ *     key_id - ID of the key to sign with
+ *     opcode - Index of the command in the device's table
+ *     timestamp - Seconds since the epoch
+ *     argument - Printable ASCII, length bytes, up to command_max_argument_length
+ *     output - Where to write the frame, at least frame_min_length + length bytes
+ *   Returns:
+ *     Length of the frame, 0 if the key is not active or the argument too long
+ */
+template <size_t Keys>
+size_t sign_frame(const keyring<Keys> &keys, size_t key_id, uint8_t opcode, uint32_t timestamp,
+                  const uint8_t argument[], size_t length, uint8_t output[]) {
+  if(key_id > 15 || !keys.contains(key_id) || length > command_max_argument_length) return 0;
+  
+  output[0] = frame_version;
+  output[1] = opcode;
+  output[2] = (uint8_t) key_id;
+  output[3] = (uint8_t) (timestamp >> 24);
+  output[4] = (uint8_t) (timestamp >> 16);
+  output[5] = (uint8_t) (timestamp >> 8);
+  output[6] = (uint8_t) timestamp;
+  output[7] = (uint8_t) length;
+  if(length) memcpy(output + frame_header_length, argument, length);
+  keys.sign(key_id, output, frame_header_length + length, output + frame_header_length + length);
+  return frame_min_length + length;
+}
+
+// Whether a frame of at least one byte is a batch
+inline bool is_batch_frame(const uint8_t payload[]) {
+  return payload[0] == frame_batch_version;
+}
+
+/* parse_batch:
+ *   Description:
+ *     parse_frame() for batches, of at most frame_batch_max_length bytes. Checks every command in it, so
+ *     next_batch_command() can walk them without checking again
+ *   Parameters:
+ *     payload - The received batch, length bytes
+ *     batch - Set, if it is well formed, to the key ID, timestamp, signed part and tag of the batch, and the
+ *             number of commands as opcode
+ *   Returns:
+ *     Whether it is well formed: known version, 1 to frame_max_batch commands that exactly fill the space
+ *     before the tag, key ID of one hex digit and printable arguments of up to command_max_argument_length
+ */
+inline bool parse_batch(const uint8_t payload[], size_t length, command_view &batch) {
+  if(length < frame_batch_header_length + frame_tag_length) return false;
+  if(payload[0] != frame_batch_version || payload[1] == 0 || payload[1] > frame_max_batch || payload[2] > 15) return false;
+  
+  size_t end = length - frame_tag_length, position = frame_batch_header_length;
+  for(size_t i = 0; i < payload[1]; ++i) {
+    if(end - position < 2 || payload[position + 1] > command_max_argument_length) return false;
+    size_t argument_length = payload[position + 1];
+    position += 2;
+    if(end - position < argument_length) return false;
+    for(size_t j = 0; j < argument_length; ++j) {
+      if(payload[position + j] < ' ' || payload[position + j] > '~') return false;
+    }
+    position += argument_length;
+  }
+  if(position != end) return false;
+  
+  batch.opcode = payload[1];
+  batch.key_id = payload[2];
+  batch.timestamp = (uint32_t) payload[3] << 24 | (uint32_t) payload[4] << 16 | (uint32_t) payload[5] << 8 | payload[6];
+  batch.name_start = 1;
+  batch.name_length = 0;
+  batch.argument_start = frame_batch_header_length;
+  batch.argument_length = end - frame_batch_header_length;
+  batch.length = end;
+  batch.signature_length = frame_tag_length;
+  return true;
+}
+
+/* next_batch_command:
+ *   Description:
+ *     Walks the commands of a batch parse_batch() accepted
+ *   Parameters:
+ *     payload - The batch
+ *     batch - From parse_batch()
+ *     position - Offset of the next command, frame_batch_header_length for the first. Advanced past it
+ *     command - Set to the command, with the key ID, timestamp and signed part of the batch
+ *   Returns:
+ *     Whether there was a command left
+ */
+inline bool next_batch_command(const uint8_t payload[], const command_view &batch, size_t &position, command_view &command) {
+  if(position >= batch.length) return false;
+  
+  command = batch;
+  command.opcode = payload[position];
+  command.argument_start = position + 2;
+  command.argument_length = payload[position + 1];
+  position = command.argument_start + command.argument_length;
+  return true;
+}
+
+/* start_batch:
+ *   Description:
+ *     Writes the header of an empty batch, for add_to_batch() and sign_batch()
+ *   Parameters:
+ *     output - At least frame_batch_max_length bytes
+ *   Returns:
+ *     Length so far
+ */
+inline size_t start_batch(size_t key_id, uint32_t timestamp, uint8_t output[]) {
+  output[0] = frame_batch_version;
+  output[1] = 0;
+  output[2] = (uint8_t) key_id;
+  output[3] = (uint8_t) (timestamp >> 24);
+  output[4] = (uint8_t) (timestamp >> 16);
+  output[5] = (uint8_t) (timestamp >> 8);
+  output[6] = (uint8_t) timestamp;
+  return frame_batch_header_length;
+}
+
+/* add_to_batch:
+ *   Description:
+ *     Appends a command to a batch
+ *   Parameters:
+ *     output - The batch, length bytes so far
+ *     opcode - Index of the command in the device's table
+ *     argument - Printable ASCII, argument_length bytes, up to command_max_argument_length
+ *   Returns:
+ *     New length, 0 if the batch is full or there is no room left for the command and the tag
+ */
+inline size_t add_to_batch(uint8_t output[], size_t length, uint8_t opcode, const uint8_t argument[], size_t argument_length) {
+  if(output[1] == frame_max_batch || argument_length > command_max_argument_length ||
+     length + 2 + argument_length + frame_tag_length > frame_batch_max_length) return 0;
+  
+  ++output[1];
+  output[length] = opcode;
+  output[length + 1] = (uint8_t) argument_length;
+  if(argument_length) memcpy(output + length + 2, argument, argument_length);
+  return length + 2 + argument_length;
+}
+
+/* sign_batch:
+ *   Description:
+ *     Appends the tag to a batch
+ *   Parameters:
+ *     keys - Keys to sign with, including the batch's key ID
+ *     output - The batch, length bytes so far, with room for the tag
+ *   Returns:
+ *     Length of the signed batch, 0 if the key is not active or the batch is empty
+ */
+template <size_t Keys>
+size_t sign_batch(const keyring<Keys> &keys, uint8_t output[], size_t length) {
+  if(output[2] > 15 || !keys.contains(output[2]) || output[1] == 0) return 0;
+  keys.sign(output[2], output, length, output + length);
+  return length + frame_tag_length;
+}
+
+#endif // ifndef
@@ -0,0 +1,117 @@
+/**
+ * Signing keys selected by a short key ID carried in each message, so keys can be added and retired while
+ * the older ones are still in use
+ */
+
+#ifndef SEVERINO_KEYRING_H_INCLUDED
+#define SEVERINO_KEYRING_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "blake2s.hpp"
+
+/* keyring<Keys>:
+ *   Description:
+ *     Keys slots, indexed by key ID. Each active slot holds the BLAKE2s state with its key block already
+ *     compressed (see blake2s_precompute_key()), not the key itself, so selecting a key is an array lookup and
+ *     signing costs one compression for a short message whichever key is used and however many there are
+ *   Parameters:
+ *     Keys - Number of key IDs, 0 to Keys - 1
+ */
+template <size_t Keys = 8>
+struct keyring {
+  blake2s_state states[Keys];
+  bool active[Keys];
+  
+  keyring() {
+    clear();
+  }
+  
+  // Retires every key
+  void clear() {
+    memset(states, 0, sizeof(states));
+    memset(active, 0, sizeof(active));
+  }
+  
+  /* add:
+   *   Description:
+   *     Sets the key of a slot, replacing the one it held
+   *   Parameters:
+   *     id - Key ID
+   *     key - The key, key_length bytes, 1 to 32
+   *     digest_length - Length of the tags signed with it, 1 to 32 bytes
+   *   Returns:
+   *     Whether id and the lengths were valid
+   */
+  bool add(size_t id, const uint8_t key[], size_t key_length, size_t digest_length) {
+    if(id >= Keys || key_length == 0 || key_length > 32 || digest_length == 0 || digest_length > 32) return false;
+    
+    blake2s_init(&states[id], digest_length, key, key_length);
+    blake2s_precompute_key(&states[id]);
+    active[id] = true;
+    return true;
+  }
+  
+  // Retires a key, messages signed with it are no longer accepted. Returns whether it was active
+  bool retire(size_t id) {
+    if(!contains(id)) return false;
+    memset(&states[id], 0, sizeof(states[id]));
+    active[id] = false;
+    return true;
+  }
+  
+  bool contains(size_t id) const {
+    return id < Keys && active[id];
+  }
+  
+  /* sign:
+   *   Description:
+   *     Keyed BLAKE2s of a message, with the key of a slot
+   *   Parameters:
+   *     id - Key ID
+   *     message - Message to sign, length bytes, at least 1
+   *     tag - Where to write the tag, as many bytes as the digest length the key was added with
+   *   Returns:
+   *     Whether the key is active, if not tag is left untouched
+   */
+  bool sign(size_t id, const uint8_t message[], size_t length, uint8_t tag[]) const {
+    if(!contains(id)) return false;
+    
+    blake2s_state state = states[id];
+    blake2s_update(&state, message, length);
+    blake2s_final(&state, tag);
+    return true;
+  }
+  
+  /* mask_key:
+   *   Description:
+   *     XORs a 32-byte key with a pad derived from the key of a slot and a context, the tags of context
+   *     followed by a block counter byte. Masks a new key so it can be sent in a signed message without the
+   *     broker learning it, and unmasks it on the device: applying it twice gives the key back. The context
+   *     must not repeat for a given key, use the signed message that carries the masked key
+   *   Parameters:
+   *     id - Key ID of the masking key
+   *     context - Data the pad is derived from, length bytes
+   *     key - The 32 bytes to mask or unmask, in place
+   *   Returns:
+   *     Whether the masking key is active
+   */
+  bool mask_key(size_t id, const uint8_t context[], size_t length, uint8_t key[32]) const {
+    if(!contains(id)) return false;
+    
+    size_t digest_length = states[id].digest_length;
+    uint8_t pad[32];
+    for(uint8_t block = 0; block*digest_length < 32; ++block) {
+      blake2s_state state = states[id];
+      blake2s_update(&state, context, length);
+      blake2s_update(&state, &block, 1);
+      blake2s_final(&state, pad);
+      
+      for(size_t i = 0; i < digest_length && block*digest_length + i < 32; ++i) key[block*digest_length + i] ^= pad[i];
+    }
+    return true;
+  }
+};
+
+#endif // ifndef
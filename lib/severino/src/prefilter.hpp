@@ -0,0 +1,225 @@
+/**
+ * Cheap checks run on every received message before its MAC is computed, and a rate limit on the MAC
+ * computations themselves, so that whoever can publish to the broker cannot keep the device busy hashing
+ */
+
+#ifndef SEVERINO_PREFILTER_H_INCLUDED
+#define SEVERINO_PREFILTER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "command.hpp"
+#include "frame.hpp"
+#include "registry.hpp"
+
+/* token_bucket:
+ *   Description:
+ *     Allows bursts of up to capacity events, refilled at one per period. The level is kept in milliseconds
+ *     of credit rather than in tokens, so refilling is an addition and there is nothing to overflow; the
+ *     difference of millis() readings also stays right when millis() wraps around. Starts full
+ */
+struct token_bucket {
+  uint32_t capacity;  // Tokens
+  uint32_t period;    // Milliseconds per token
+  uint32_t level;     // Milliseconds of credit, at most capacity*period
+  uint32_t last;      // Time of the last take()
+  
+  /* token_bucket:
+   *   Parameters:
+   *     capacity - Largest burst, in tokens, at least 1
+   *     period - Milliseconds to earn a token back, at least 1. capacity*period must fit in 32 bits
+   *     now - Current time, in milliseconds
+   */
+  token_bucket(uint32_t capacity, uint32_t period, uint32_t now = 0) :
+    capacity(capacity), period(period), level(capacity*period), last(now) {}
+  
+  /* take:
+   *   Description:
+   *     Takes a token if there is one
+   *   Parameters:
+   *     now - Current time, in milliseconds, from the same clock as the previous calls
+   *   Returns:
+   *     Whether a token was taken
+   */
+  bool take(uint32_t now) {
+    uint32_t elapsed = now - last;
+    uint32_t full = capacity*period;
+    
+    last = now;
+    level = elapsed >= full - level ? full : level + elapsed;
+    if(level < period) return false;
+    level -= period;
+    return true;
+  }
+};
+
+/* prefilter:
+ *   Description:
+ *     Staged rejection of `[id.]name:timestamp[:argument]<separator>signature` messages, where id is the key
+ *     ID, one hex digit (0 if left out), and argument printable ASCII. Cheapest stage first:
+ *       TOPIC - received on another topic
+ *       SIZE - no separator, or the command part or the signature does not have an accepted length
+ *       FORMAT - the command part does not have the format above (parse_command()), or (reported by the
+ *                caller through reject()) the signature does not decode
+ *       COMMAND - unknown command name, looked up in the command_table the prefilter was built from (one hash
+ *                 and one comparison) or, built from a list of names, compared with each
+ *       KEY - (reported by the caller) no active key with that ID
+ *       RATE - more MAC computations than the token bucket allows
+ *     screen() runs the first four stages on the raw message, admit() the last one right before the MAC is
+ *     computed. screen_frame() runs them on binary frames (frame.hpp), from a topic of their own. Every
+ *     rejection is counted per stage, and every admitted message in admitted
+ */
+struct prefilter {
+  enum stage {
+    TOPIC,
+    SIZE,
+    FORMAT,
+    COMMAND,
+    KEY,
+    RATE,
+    STAGES
+  };
+  
+  // Where screen() found the parts of an accepted message, timestamp included
+  typedef command_view message;
+  
+  // Index of a command by name, -1 if unknown, such as command_table::find() through table_lookup()
+  typedef int (*command_lookup)(const void *context, const uint8_t name[], size_t length);
+  
+  const char *topic;
+  const char *frame_topic;      // NULL if binary frames are not accepted
+  const char *const *commands;  // For max_length and the opcodes of frames
+  size_t command_count;
+  command_lookup lookup;        // NULL to compare the name with each of commands
+  const void *lookup_context;
+  const uint8_t *signature_lengths;
+  size_t signature_length_count;
+  char separator;
+  size_t max_length;  // Key ID, longest command name, timestamp and argument
+  token_bucket bucket;
+  uint32_t rejected[STAGES];
+  uint32_t admitted;
+  
+  /* prefilter:
+   *   Parameters:
+   *     topic - The only topic commands are accepted from
+   *     commands - Known command names, command_count of them. Not copied
+   *     signature_lengths - Accepted signature lengths, in characters, signature_length_count of them. Not
+   *                         copied
+   *     separator - Character between the command and its signature
+   *     bucket - Limit on the rate of admit()
+   *     frame_topic - The only topic binary frames are accepted from, NULL for none
+   */
+  prefilter(const char *topic, const char *const commands[], size_t command_count,
+            const uint8_t signature_lengths[], size_t signature_length_count, char separator, token_bucket bucket,
+            const char *frame_topic = NULL) :
+    topic(topic), frame_topic(frame_topic), commands(commands), command_count(command_count), lookup(NULL),
+    lookup_context(NULL), signature_lengths(signature_lengths), signature_length_count(signature_length_count),
+    separator(separator), max_length(0), bucket(bucket), admitted(0) {
+    for(size_t i = 0; i < command_count; ++i) {
+      size_t length = 2 + strlen(commands[i]) + 1 + command_max_timestamp_digits + 1 + command_max_argument_length;
+      if(length > max_length) max_length = length;
+    }
+    memset(rejected, 0, sizeof(rejected));
+  }
+  
+  /* prefilter:
+   *   Description:
+   *     Takes the commands from a table, whose perfect hash the COMMAND stage then uses. The table is not
+   *     copied
+   */
+  template <size_t Count>
+  prefilter(const char *topic, const command_table<Count> &table,
+            const uint8_t signature_lengths[], size_t signature_length_count, char separator, token_bucket bucket,
+            const char *frame_topic = NULL) :
+    prefilter(topic, table.names, Count, signature_lengths, signature_length_count, separator, bucket, frame_topic) {
+    lookup = table_lookup<Count>;
+    lookup_context = &table;
+  }
+  
+  template <size_t Count>
+  static int table_lookup(const void *context, const uint8_t name[], size_t length) {
+    return ((const command_table<Count> *) context)->find(name, length);
+  }
+  
+  // Counts a rejection at a stage checked by the caller (FORMAT for a signature that does not decode, KEY)
+  bool reject(stage s) {
+    ++rejected[s];
+    return false;
+  }
+  
+  /* screen:
+   *   Description:
+   *     Runs the checks that need only the message itself: topic, sizes, format and command name
+   *   Parameters:
+   *     received_topic - Topic the message was published on
+   *     payload - The message, length bytes, not null-terminated
+   *     found - Set to where the parts of the message are, if it passes
+   *   Returns:
+   *     Whether the message passed, if not the stage that rejected it is counted
+   */
+  bool screen(const char *received_topic, const uint8_t payload[], size_t length, message &found) {
+    if(strcmp(received_topic, topic) != 0) return reject(TOPIC);
+    
+    // Only the first max_length + 1 bytes can hold the separator of an acceptable message
+    if(!split_command(payload, length, separator, max_length, found)) return reject(SIZE);
+    
+    bool known_length = false;
+    for(size_t i = 0; i < signature_length_count; ++i) known_length |= found.signature_length == signature_lengths[i];
+    if(!known_length) return reject(SIZE);
+    
+    if(!parse_command(payload, found)) return reject(FORMAT);
+    
+    if(lookup) return lookup(lookup_context, payload + found.name_start, found.name_length) >= 0 || reject(COMMAND);
+    for(size_t i = 0; i < command_count; ++i) {
+      if(command_name_is(payload, found, commands[i])) return true;
+    }
+    return reject(COMMAND);
+  }
+  
+  /* screen_frame:
+   *   Description:
+   *     screen() for binary frames (frame.hpp): topic, length, layout (parse_frame() or, for batches,
+   *     parse_batch()) and opcodes, which must be the index of one of the commands. The tag is the
+   *     signature_length raw bytes after the signed part
+   *   Parameters:
+   *     received_topic - Topic the frame was published on
+   *     payload - The frame, length bytes
+   *     found - Set to where the parts of the frame are, if it passes
+   *   Returns:
+   *     Whether the frame passed, if not the stage that rejected it is counted
+   */
+  bool screen_frame(const char *received_topic, const uint8_t payload[], size_t length, message &found) {
+    if(frame_topic == NULL || strcmp(received_topic, frame_topic) != 0) return reject(TOPIC);
+    if(length < frame_min_length || length > frame_batch_max_length) return reject(SIZE);
+    if(!is_batch_frame(payload)) {
+      if(!parse_frame(payload, length, found)) return reject(FORMAT);
+      return found.opcode < command_count || reject(COMMAND);
+    }
+    
+    if(!parse_batch(payload, length, found)) return reject(FORMAT);
+    size_t position = frame_batch_header_length;
+    command_view command;
+    while(next_batch_command(payload, found, position, command)) {
+      if(command.opcode >= command_count) return reject(COMMAND);
+    }
+    return true;
+  }
+  
+  /* admit:
+   *   Description:
+   *     Last stage, right before the MAC is computed: takes a token from the bucket
+   *   Parameters:
+   *     now - Current time, in milliseconds
+   *   Returns:
+   *     Whether the MAC may be computed
+   */
+  bool admit(uint32_t now) {
+    if(!bucket.take(now)) return reject(RATE);
+    ++admitted;
+    return true;
+  }
+};
+
+#endif // ifndef
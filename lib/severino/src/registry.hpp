@@ -0,0 +1,220 @@
+/**
+ * Table of the commands a device accepts, fixed at compile time: name, argument schema and handler of each.
+ * Names are looked up through a perfect hash whose seed is searched for when the table is built, at compile
+ * time for a constexpr table, so a lookup costs one hash of the name and at most one comparison however many
+ * commands there are. command_registry adds invocation and latency counters per command
+ */
+
+#ifndef SEVERINO_REGISTRY_H_INCLUDED
+#define SEVERINO_REGISTRY_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "command.hpp"
+
+/* argument_kind:
+ *   Description:
+ *     Characters a command's argument is made of:
+ *       ARGUMENT_NONE   - no argument
+ *       ARGUMENT_DIGITS - decimal digits
+ *       ARGUMENT_HEX    - lowercase hex digits
+ *       ARGUMENT_TEXT   - any printable ASCII, which parse_command() already checked
+ */
+enum argument_kind {
+  ARGUMENT_NONE,
+  ARGUMENT_DIGITS,
+  ARGUMENT_HEX,
+  ARGUMENT_TEXT
+};
+
+// What a command's argument must look like. An argument may be left out only if min_length is 0
+struct argument_schema {
+  argument_kind kind;
+  uint8_t min_length;
+  uint8_t max_length;
+};
+
+// Whether an argument, length bytes, fits a schema
+inline bool argument_matches(const argument_schema &schema, const uint8_t argument[], size_t length) {
+  if(schema.kind == ARGUMENT_NONE) return length == 0;
+  if(length < schema.min_length || length > schema.max_length) return false;
+  for(size_t i = 0; i < length; ++i) {
+    uint8_t c = argument[i];
+    bool digit = c >= '0' && c <= '9';
+    if(schema.kind == ARGUMENT_DIGITS && !digit) return false;
+    if(schema.kind == ARGUMENT_HEX && !digit && !(c >= 'a' && c <= 'f')) return false;
+  }
+  return true;
+}
+
+/* command_handler:
+ *   Description:
+ *     Runs an authenticated command whose argument matched its schema
+ *   Parameters:
+ *     payload - The received message
+ *     command - Where its parts are, the argument at command.argument_start
+ *   Returns:
+ *     Whether it was carried out
+ */
+typedef bool (*command_handler)(const uint8_t payload[], const command_view &command);
+
+struct command_spec {
+  const char *name;
+  argument_schema argument;
+  command_handler handler;
+};
+
+// FNV-1a of a name, starting from a seed instead of the usual offset basis
+constexpr uint32_t command_hash(const uint8_t name[], size_t length, uint32_t seed) {
+  uint32_t hash = seed;
+  for(size_t i = 0; i < length; ++i) hash = (hash ^ name[i])*16777619u;
+  return hash;
+}
+
+constexpr uint32_t command_hash(const char *name, uint32_t seed) {
+  uint32_t hash = seed;
+  for(; *name; ++name) hash = (hash ^ (uint8_t) *name)*16777619u;
+  return hash;
+}
+
+// Slots of a table of a number of commands: a power of two, at least twice as many, so a seed is quick to find
+constexpr size_t command_slots(size_t count) {
+  size_t slots = 2;
+  while(slots < 2*count) slots *= 2;
+  return slots;
+}
+
+/* command_table:
+ *   Description:
+ *     Commands and their perfect hash. Declared constexpr, the seed is searched for by the compiler and
+ *     static_assert(table.perfect) turns names that cannot be told apart into a build error
+ *   Parameters:
+ *     Count - Number of commands, at most 255
+ */
+template <size_t Count>
+struct command_table {
+  static constexpr size_t slot_count = command_slots(Count);
+  
+  command_spec specs[Count];
+  const char *names[Count];   // For prefilter's longest name and frame opcodes
+  uint8_t slots[slot_count];  // Index + 1 of the command whose name hashes there, 0 for none
+  uint32_t seed;
+  bool perfect;               // Whether a seed without collisions was found
+  
+  constexpr command_table(const command_spec (&commands)[Count]) : specs(), names(), slots(), seed(0), perfect(false) {
+    for(size_t i = 0; i < Count; ++i) {
+      specs[i] = commands[i];
+      names[i] = commands[i].name;
+    }
+    for(uint32_t candidate = 2166136261u; !perfect && candidate < 2166136261u + 4096; ++candidate) {
+      for(size_t s = 0; s < slot_count; ++s) slots[s] = 0;
+      perfect = true;
+      for(size_t i = 0; i < Count && perfect; ++i) {
+        size_t slot = command_hash(commands[i].name, candidate) & (slot_count - 1);
+        perfect = slots[slot] == 0;
+        slots[slot] = (uint8_t) (i + 1);
+      }
+      seed = candidate;
+    }
+  }
+  
+  /* find:
+   *   Description:
+   *     Index of a command by name
+   *   Parameters:
+   *     name - The name, length bytes, not null-terminated
+   *   Returns:
+   *     Its index in specs, -1 if there is no such command
+   */
+  int find(const uint8_t name[], size_t length) const {
+    uint8_t index = slots[command_hash(name, length, seed) & (slot_count - 1)];
+    if(index == 0) return -1;
+    const char *candidate = specs[index - 1].name;
+    return strlen(candidate) == length && memcmp(candidate, name, length) == 0 ? index - 1 : -1;
+  }
+};
+
+// Invocations of a command, rejected ones included, and the time its handler took
+struct command_stats {
+  uint32_t calls;
+  uint32_t bad_arguments;  // Refused by the schema, the handler was not called
+  uint32_t failures;       // Handler returned false
+  uint32_t total_time;     // Over all handler calls, in units of the clock dispatch() was given
+  uint32_t max_time;
+};
+
+/* command_registry:
+ *   Description:
+ *     Dispatches authenticated commands to the handlers of a table, counting per command. The results are
+ *       COMMAND_DONE         - the handler carried it out
+ *       COMMAND_FAILED       - the handler refused it
+ *       COMMAND_BAD_ARGUMENT - the argument does not fit the schema
+ *       COMMAND_UNKNOWN      - no command by that name
+ */
+template <size_t Count>
+struct command_registry {
+  enum result {
+    COMMAND_DONE,
+    COMMAND_FAILED,
+    COMMAND_BAD_ARGUMENT,
+    COMMAND_UNKNOWN
+  };
+  
+  const command_table<Count> &table;
+  command_stats stats[Count];
+  
+  command_registry(const command_table<Count> &table) : table(table) {
+    clear();
+  }
+  
+  void clear() {
+    memset(stats, 0, sizeof(stats));
+  }
+  
+  /* dispatch:
+   *   Description:
+   *     Checks a command's argument against its schema and calls its handler
+   *   Parameters:
+   *     payload - The received message, authenticated
+   *     command - Where its parts are
+   *     clock - Called before and after the handler for its latency, such as micros
+   *   Returns:
+   *     What became of it
+   */
+  template <typename Clock>
+  result dispatch(const uint8_t payload[], const command_view &command, Clock clock) {
+    int index = table.find(payload + command.name_start, command.name_length);
+    if(index < 0) return COMMAND_UNKNOWN;
+    return run(index, payload, command, clock);
+  }
+  
+  // dispatch() for binary frames, which carry the command's index in the table as their opcode
+  template <typename Clock>
+  result dispatch_opcode(const uint8_t payload[], const command_view &command, Clock clock) {
+    if(command.opcode >= Count) return COMMAND_UNKNOWN;
+    return run(command.opcode, payload, command, clock);
+  }
+  
+  template <typename Clock>
+  result run(size_t index, const uint8_t payload[], const command_view &command, Clock clock) {
+    const command_spec &spec = table.specs[index];
+    command_stats &s = stats[index];
+    ++s.calls;
+    if(!argument_matches(spec.argument, payload + command.argument_start, command.argument_length)) {
+      ++s.bad_arguments;
+      return COMMAND_BAD_ARGUMENT;
+    }
+    
+    uint32_t start = clock();
+    bool done = spec.handler(payload, command);
+    uint32_t elapsed = (uint32_t) clock() - start;
+    s.total_time += elapsed;
+    if(elapsed > s.max_time) s.max_time = elapsed;
+    if(done) return COMMAND_DONE;
+    ++s.failures;
+    return COMMAND_FAILED;
+  }
+};
+
+#endif // ifndef
@@ -0,0 +1,99 @@
+/**
+ * Replay protection for signed commands. A command is accepted once, and only while its timestamp is close to
+ * the current (synced) time
+ */
+
+#ifndef SEVERINO_REPLAY_GUARD_H_INCLUDED
+#define SEVERINO_REPLAY_GUARD_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* replay_guard<Slots, Probes>:
+ *   Description:
+ *     Rejects commands whose timestamp is more than window seconds away from now, and commands seen before.
+ *     Accepted commands are remembered as a (timestamp, first 8 tag bytes) pair in an open-addressed table of
+ *     Slots entries, indexed by the tag (a MAC, so already uniformly distributed). Lookups always scan the same
+ *     Probes slots, so they take constant time and memory is fixed at 12 bytes per slot. Entries whose
+ *     timestamp has left the window are reused, they can no longer pass the window check anyway. If all
+ *     Probes slots hold live entries the command is rejected rather than evicting one, which could let it be
+ *     replayed: size Slots for the number of distinct commands expected within a window
+ *   Parameters:
+ *     Slots - Table size, a power of 2
+ *     Probes - Slots scanned per lookup, at most Slots
+ */
+template <size_t Slots = 64, size_t Probes = 8>
+struct replay_guard {
+  static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0, "Slots must be a power of 2");
+  static_assert(Probes > 0 && Probes <= Slots, "Probes must be between 1 and Slots");
+  
+  enum result {
+    ACCEPTED,
+    OUTSIDE_WINDOW,  // Too old, or too far in the future
+    REPLAYED,        // Seen before
+    FULL             // No free slot among the probed ones
+  };
+  
+  struct entry {
+    uint32_t timestamp;    // 0 for never used
+    uint8_t fingerprint[8];
+  };
+  
+  uint32_t window;
+  entry entries[Slots];
+  
+  /* replay_guard:
+   *   Parameters:
+   *     window - Largest accepted difference, in seconds, between a command's timestamp and now
+   */
+  explicit replay_guard(uint32_t window) : window(window) {
+    clear();
+  }
+  
+  // Forgets every command seen
+  void clear() {
+    memset(entries, 0, sizeof(entries));
+  }
+  
+  /* check:
+   *   Description:
+   *     Decides whether an authenticated command may run, and remembers it if so
+   *   Parameters:
+   *     now - Current time, in seconds (Unix time)
+   *     timestamp - Timestamp carried by the command, in the same unit
+   *     tag - The command's MAC tag, at least 8 bytes
+   *   Returns:
+   *     ACCEPTED, or why the command was rejected
+   */
+  result check(uint32_t now, uint32_t timestamp, const uint8_t tag[]) {
+    if(!in_window(now, timestamp)) return OUTSIDE_WINDOW;
+    
+    size_t start = ((size_t) tag[0] | (size_t) tag[1] << 8 | (size_t) tag[2] << 16) & (Slots - 1);
+    size_t free_slot = Slots;
+    bool seen = false;
+    
+    // Scans every probed slot, whatever is found, so the time taken does not depend on the table contents
+    for(size_t i = 0; i < Probes; ++i) {
+      entry &e = entries[(start + i) & (Slots - 1)];
+      bool live = e.timestamp != 0 && in_window(now, e.timestamp);
+      
+      seen |= live && e.timestamp == timestamp && memcmp(e.fingerprint, tag, 8) == 0;
+      if(!live && free_slot == Slots) free_slot = (start + i) & (Slots - 1);
+    }
+    
+    if(seen) return REPLAYED;
+    if(free_slot == Slots) return FULL;
+    
+    entries[free_slot].timestamp = timestamp;
+    memcpy(entries[free_slot].fingerprint, tag, 8);
+    return ACCEPTED;
+  }
+  
+  bool in_window(uint32_t now, uint32_t timestamp) const {
+    int32_t difference = (int32_t) (timestamp - now);
+    return timestamp != 0 && difference >= -(int32_t) window && difference <= (int32_t) window;
+  }
+};
+
+#endif // ifndef
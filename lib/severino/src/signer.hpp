@@ -0,0 +1,173 @@
+/**
+ * Signing and framing of text commands, `[id.]command$signature`, shared by the firmware (which decodes and
+ * checks signatures) and host tools (which produce them, or check recorded ones). Includes base64.hpp and
+ * z85.hpp, so like them it can only be included in one source file per program
+ */
+
+#ifndef SEVERINO_SIGNER_H_INCLUDED
+#define SEVERINO_SIGNER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "base64.hpp"
+#include "z85.hpp"
+#include "keyring.hpp"
+#include "constant_time.hpp"
+#include "prefilter.hpp"
+
+// Tag length of the signed commands, the digest length of the keyring keys
+static const size_t signature_tag_length = 16;
+
+/* signature_format:
+ *   Description:
+ *     How the tag is written after the separator, told apart by length:
+ *       SIGNATURE_BASE64    - standard base64, padded, 24 characters
+ *       SIGNATURE_BASE64URL - URL-safe base64, unpadded, 22 characters
+ *       SIGNATURE_Z85       - Z85, 20 characters
+ */
+enum signature_format {
+  SIGNATURE_BASE64,
+  SIGNATURE_BASE64URL,
+  SIGNATURE_Z85
+};
+
+static const size_t signature_lengths[] = {
+  base64_encoded_size<signature_tag_length>,
+  base64_encoded_size<signature_tag_length, base64_url_unpadded>,
+  z85_encoded_size<signature_tag_length>
+};
+
+// Longest signature, for sizing buffers
+static const size_t signature_max_length = base64_encoded_size<signature_tag_length>;
+
+/* signature_format_of:
+ *   Description:
+ *     Format of a signature of a given length
+ *   Parameters:
+ *     length - Signature length, in characters
+ *     format - Set to the format, if there is one of that length
+ *   Returns:
+ *     Whether there is one
+ */
+inline bool signature_format_of(size_t length, signature_format &format) {
+  for(size_t f = 0; f < sizeof(signature_lengths)/sizeof(signature_lengths[0]); ++f) {
+    if(length == signature_lengths[f]) {
+      format = (signature_format) f;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Writes the signature_lengths[format] characters of a tag's signature
+inline void encode_signature(signature_format format, const uint8_t tag[], uint8_t signature[]) {
+  switch(format) {
+    case SIGNATURE_BASE64URL: encode_base64<signature_tag_length, base64_url_unpadded>(tag, signature); break;
+    case SIGNATURE_Z85: encode_z85<signature_tag_length>(tag, signature); break;
+    default: encode_base64<signature_tag_length>(tag, signature);
+  }
+}
+
+/* decode_signature:
+ *   Description:
+ *     Decodes the signature_lengths[format] characters of a signature, rejecting anything but the canonical
+ *     encoding of a tag
+ *   Returns:
+ *     Whether the signature was valid, tag is undefined if not
+ */
+inline bool decode_signature(signature_format format, const uint8_t signature[], uint8_t tag[]) {
+  switch(format) {
+    case SIGNATURE_BASE64URL: return decode_base64_strict<signature_tag_length, base64_url_unpadded>(signature, tag);
+    case SIGNATURE_Z85: return decode_z85<signature_tag_length>(signature, tag);
+    default: return decode_base64_strict<signature_tag_length>(signature, tag);
+  }
+}
+
+// Longest signed command sign_command() writes for a command of a given length
+inline size_t signed_command_max_length(size_t command_length) {
+  return 2 + command_length + 1 + signature_max_length;
+}
+
+/* frame_command:
+ *   Description:
+ *     Writes the signed part of a command: the key ID and '.' (left out for key 0, as in the older format)
+ *     and the command
+ *   Parameters:
+ *     key_id - Key ID, 0 to 15
+ *     command - Command, such as `liberar:1700000000`, length bytes
+ *     output - Where to write it, at least length + 2 bytes
+ *   Returns:
+ *     Length written
+ */
+inline size_t frame_command(size_t key_id, const uint8_t command[], size_t length, uint8_t output[]) {
+  size_t position = 0;
+  if(key_id != 0) {
+    output[position++] = "0123456789abcdef"[key_id];
+    output[position++] = '.';
+  }
+  memcpy(output + position, command, length);
+  return position + length;
+}
+
+/* sign_command:
+ *   Description:
+ *     Writes a ready to publish command: frame_command(), the separator and the signature of the framed part
+ *   Parameters:
+ *     keys - Keys to sign with, added with a digest length of signature_tag_length
+ *     key_id - ID of the key to sign with
+ *     command - Command, such as `liberar:1700000000`, length bytes, at least 1
+ *     format - Signature format
+ *     output - Where to write the message, at least signed_command_max_length(length) bytes. Not
+ *              null-terminated
+ *   Returns:
+ *     Length of the message written, 0 if the key is not active or key_id is more than one hex digit
+ */
+template <size_t Keys>
+size_t sign_command(const keyring<Keys> &keys, size_t key_id, const uint8_t command[], size_t length,
+                    signature_format format, uint8_t output[], char separator = '$') {
+  if(key_id > 15 || !keys.contains(key_id) || length == 0) return 0;
+  
+  size_t position = frame_command(key_id, command, length, output);
+  uint8_t tag[signature_tag_length];
+  keys.sign(key_id, output, position, tag);
+  output[position++] = separator;
+  encode_signature(format, tag, output + position);
+  return position + signature_lengths[format];
+}
+
+/* decode_message_signature:
+ *   Description:
+ *     Decodes the signature of a message prefilter::screen() accepted, in the format its length tells
+ *   Parameters:
+ *     payload - The message
+ *     found - Where screen() found its parts
+ *     tag - Where to write the signature_tag_length bytes of the tag
+ *   Returns:
+ *     Whether the signature is the canonical encoding of a tag in a known format
+ */
+inline bool decode_message_signature(const uint8_t payload[], const prefilter::message &found, uint8_t tag[]) {
+  signature_format format;
+  if(!signature_format_of(found.signature_length, format)) return false;
+  return decode_signature(format, payload + found.length + 1, tag);
+}
+
+/* check_signature:
+ *   Description:
+ *     Compares a received tag with the one computed over the signed part of a message, in constant time
+ *   Parameters:
+ *     keys - Keys the message may be signed with
+ *     key_id - ID of the key it says it is signed with, which must be active
+ *     message - The signed part, length bytes, at least 1
+ *     tag - The received tag, signature_tag_length bytes
+ *   Returns:
+ *     Whether the tag is right
+ */
+template <size_t Keys>
+bool check_signature(const keyring<Keys> &keys, size_t key_id, const uint8_t message[], size_t length, const uint8_t tag[]) {
+  uint8_t computed[signature_tag_length];
+  keys.sign(key_id, message, length, computed);
+  return constant_time_equal(computed, tag, signature_tag_length);
+}
+
+#endif // ifndef
@@ -0,0 +1,329 @@
+// Re-verifies recorded commands on the host, for audits. Build with `make verify`
+//
+// Memory-maps a capture of testarhs/porta payloads, one per line, and checks each one as mqtt_callback() does:
+// prefilter::screen() for the format and command, decode_message_signature() and check_signature() against
+// the keys given (the historical keys, by ID). The file is cut into chunks, spread over one worker per core;
+// a worker that runs out of chunks steals half of the remaining ones of another, so a slow region does not
+// leave the other cores idle. Payloads that pass the format checks wait in a batch per worker, hashed 8
+// (AVX2) or 4 (SSE4.1) at a time per key with blake2s_many() (one at a time with --scalar) and their tags
+// compared as check_signature() does. Reports the valid, invalid (wrong tag), unknown key and malformed counts
+// and the throughput, and with --show the byte offset of every payload that is not valid
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "signer.hpp"
+#include "blake2s_multi.hpp"
+
+typedef keyring<16> host_keyring;
+
+enum verdict {
+  VALID,
+  INVALID,
+  UNKNOWN_KEY,
+  MALFORMED,
+  VERDICTS
+};
+
+static const char *verdict_names[VERDICTS] = {"valid", "invalid", "unknown key", "malformed"};
+
+// Bytes per chunk, the unit of work and of stealing
+static const size_t chunk_size = 256*1024;
+
+// Payloads hashed together
+static const size_t batch_size = 64;
+
+/* work_range:
+ *   Description:
+ *     The chunks [begin, end) a worker has left, packed in 64 bits so that the owner taking one from the front
+ *     and thieves taking half from the back each update it with a single compare-and-swap. Aligned to a cache
+ *     line so workers do not slow each other down updating their own
+ */
+struct alignas(64) work_range {
+  std::atomic<uint64_t> range;
+  
+  static uint64_t pack(uint32_t begin, uint32_t end) {
+    return (uint64_t) begin << 32 | end;
+  }
+  
+  // Takes the first chunk, by the owner
+  bool pop(uint32_t &chunk) {
+    uint64_t current = range.load();
+    for(;;) {
+      uint32_t begin = current >> 32, end = (uint32_t) current;
+      if(begin >= end) return false;
+      if(range.compare_exchange_weak(current, pack(begin + 1, end))) {
+        chunk = begin;
+        return true;
+      }
+    }
+  }
+  
+  // Moves the back half of victim's chunks (at least one) to this range, which must be empty
+  bool steal_from(work_range &victim) {
+    uint64_t current = victim.range.load();
+    for(;;) {
+      uint32_t begin = current >> 32, end = (uint32_t) current;
+      if(begin >= end) return false;
+      uint32_t middle = end - (end - begin + 1)/2;
+      if(victim.range.compare_exchange_weak(current, pack(begin, middle))) {
+        range.store(pack(middle, end));
+        return true;
+      }
+    }
+  }
+};
+
+struct alignas(64) worker_result {
+  size_t counts[VERDICTS];
+  std::vector<std::pair<size_t, verdict> > rejected;  // Offset and verdict of what is not valid, with --show
+};
+
+// Well formed payloads of a worker waiting for their tags to be computed
+struct pending_batch {
+  size_t count;
+  uint8_t key_ids[batch_size];
+  const uint8_t *messages[batch_size];  // Signed parts
+  size_t lengths[batch_size];
+  size_t offsets[batch_size];
+  uint8_t tags[batch_size][signature_tag_length];  // Received
+};
+
+struct verifier {
+  const uint8_t *data;
+  size_t size;
+  const host_keyring *keys;
+  const prefilter *filter;
+  bool show;
+  int simd_level;
+  std::vector<work_range> ranges;
+  std::vector<worker_result> results;
+  
+  void count(worker_result &result, size_t offset, verdict v) const {
+    ++result.counts[v];
+    if(show && v != VALID) result.rejected.push_back(std::make_pair(offset, v));
+  }
+  
+  // Computes the tags of a batch, key by key, and compares them with the received ones in constant time
+  void flush(pending_batch &batch, worker_result &result) const {
+    bool done[batch_size] = {false};
+    const uint8_t *messages[batch_size];
+    size_t lengths[batch_size], indices[batch_size];
+    uint8_t computed[batch_size*signature_tag_length];
+    
+    for(size_t first = 0; first < batch.count; ++first) {
+      if(done[first]) continue;
+      
+      size_t same_key = 0;
+      for(size_t i = first; i < batch.count; ++i) {
+        if(done[i] || batch.key_ids[i] != batch.key_ids[first]) continue;
+        messages[same_key] = batch.messages[i];
+        lengths[same_key] = batch.lengths[i];
+        indices[same_key++] = i;
+        done[i] = true;
+      }
+      keyring_sign_many(*keys, batch.key_ids[first], messages, lengths, same_key, computed, simd_level);
+      
+      for(size_t j = 0; j < same_key; ++j) {
+        bool right = constant_time_equal(computed + j*signature_tag_length, batch.tags[indices[j]], signature_tag_length);
+        count(result, batch.offsets[indices[j]], right ? VALID : INVALID);
+      }
+    }
+    batch.count = 0;
+  }
+  
+  // Runs the format checks of the firmware, queueing the payload for its tag if they pass
+  void check(prefilter &filter, const uint8_t payload[], size_t length, size_t offset, pending_batch &batch,
+             worker_result &result) const {
+    prefilter::message found;
+    size_t i = batch.count;
+    
+    if(!filter.screen(filter.topic, payload, length, found)) return count(result, offset, MALFORMED);
+    if(!decode_message_signature(payload, found, batch.tags[i])) return count(result, offset, MALFORMED);
+    if(!keys->contains(found.key_id)) return count(result, offset, UNKNOWN_KEY);
+    
+    batch.key_ids[i] = found.key_id;
+    batch.messages[i] = payload;
+    batch.lengths[i] = found.length;
+    batch.offsets[i] = offset;
+    if(++batch.count == batch_size) flush(batch, result);
+  }
+  
+  // Checks the lines that start in a chunk
+  void run_chunk(prefilter &filter, uint32_t chunk, pending_batch &batch, worker_result &result) const {
+    size_t position = (size_t) chunk*chunk_size, end = std::min(position + chunk_size, size);
+    
+    // A line that starts before the chunk belongs to the previous one
+    if(position > 0 && data[position - 1] != '\n') {
+      const uint8_t *newline = (const uint8_t *) memchr(data + position, '\n', end - position);
+      if(!newline) return;
+      position = newline - data + 1;
+    }
+    
+    while(position < end) {
+      const uint8_t *newline = (const uint8_t *) memchr(data + position, '\n', size - position);
+      size_t line_end = newline ? newline - data : size;
+      size_t length = line_end - position;
+      if(length > 0 && data[line_end - 1] == '\r') --length;
+      
+      if(length > 0) check(filter, data + position, length, position, batch, result);
+      position = line_end + 1;
+    }
+  }
+  
+  void work(unsigned int worker) {
+    prefilter own_filter = *filter;
+    worker_result &result = results[worker];
+    unsigned int workers = ranges.size();
+    pending_batch batch;
+    uint32_t chunk;
+    
+    batch.count = 0;
+    for(;;) {
+      while(ranges[worker].pop(chunk)) run_chunk(own_filter, chunk, batch, result);
+      
+      bool stolen = false;
+      for(unsigned int i = 1; i < workers && !stolen; ++i) stolen = ranges[worker].steal_from(ranges[(worker + i) % workers]);
+      if(!stolen) return flush(batch, result);
+    }
+  }
+  
+  void run(unsigned int workers) {
+    size_t chunks = (size + chunk_size - 1)/chunk_size;
+    ranges = std::vector<work_range>(workers);
+    results = std::vector<worker_result>(workers);
+    for(unsigned int w = 0; w < workers; ++w) {
+      ranges[w].range.store(work_range::pack(chunks*w/workers, chunks*(w + 1)/workers));
+      memset(results[w].counts, 0, sizeof(results[w].counts));
+    }
+    
+    std::vector<std::thread> threads;
+    for(unsigned int w = 1; w < workers; ++w) threads.emplace_back([this, w] { work(w); });
+    work(0);
+    for(std::thread &thread : threads) thread.join();
+  }
+};
+
+static int hex_value(char c) {
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Parses `ID:KEY`, KEY as text or, if hex, as hex digits. Returns whether it was well formed
+static bool parse_key(const char *argument, bool hex, size_t &id, std::vector<uint8_t> &key) {
+  char *rest;
+  id = strtoul(argument, &rest, 10);
+  if(rest == argument || *rest != ':') return false;
+  
+  key.clear();
+  for(const char *c = rest + 1; *c; ++c) {
+    if(!hex) key.push_back(*c);
+    else if(c[1] && hex_value(c[0]) >= 0 && hex_value(c[1]) >= 0) key.push_back(hex_value(c[0]) << 4 | hex_value(c[1])), ++c;
+    else return false;
+  }
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: verify (--key ID:STRING | --key-hex ID:HEX)... [--commands NAME,NAME...] [--threads N]\n"
+                  "              [--z85] [--scalar] [--show] FILE\n");
+}
+
+int main(int argc, char **argv) {
+  host_keyring keys;
+  std::string command_list = "liberar,travar,abrir,status,config,reboot,chave";
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  bool show = false, z85 = false;
+  int simd_level = -1;
+  const char *path = NULL;
+  
+  for(int i = 1; i < argc; ++i) {
+    bool hex = strcmp(argv[i], "--key-hex") == 0;
+    if((hex || strcmp(argv[i], "--key") == 0) && i + 1 < argc) {
+      size_t id;
+      std::vector<uint8_t> key;
+      if(!parse_key(argv[++i], hex, id, key) || id > 15 || !keys.add(id, key.data(), key.size(), signature_tag_length)) {
+        fprintf(stderr, "verify: bad key %s, an ID of 0 to 15 and 1 to 32 bytes are needed\n", argv[i]);
+        return 2;
+      }
+    } else if(strcmp(argv[i], "--commands") == 0 && i + 1 < argc) command_list = argv[++i];
+    else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(1ul, strtoul(argv[++i], 0, 10));
+    else if(strcmp(argv[i], "--z85") == 0) z85 = true;
+    else if(strcmp(argv[i], "--scalar") == 0) simd_level = BLAKE2S_SIMD_NONE;
+    else if(strcmp(argv[i], "--show") == 0) show = true;
+    else if(argv[i][0] != '-' && !path) path = argv[i];
+    else return usage(), 2;
+  }
+  if(!path) return usage(), 2;
+  
+  // Same checks as the firmware's filter, minus the topic (taken as right) and the rate limit. Z85 signatures
+  // only with --z85, as the firmware takes them only when built with ACEITA_Z85
+  std::vector<std::string> names;
+  for(size_t start = 0, comma; start <= command_list.size(); start = comma + 1) {
+    comma = command_list.find(',', start);
+    if(comma == std::string::npos) comma = command_list.size();
+    names.push_back(command_list.substr(start, comma - start));
+  }
+  std::vector<const char *> commands;
+  for(const std::string &name : names) commands.push_back(name.c_str());
+  const uint8_t lengths[] = {(uint8_t) signature_lengths[0], (uint8_t) signature_lengths[1], (uint8_t) signature_lengths[2]};
+  prefilter filter("capture", commands.data(), commands.size(), lengths, z85 ? 3 : 2, '$', token_bucket(1, 1));
+  
+  int file = open(path, O_RDONLY);
+  struct stat status;
+  if(file < 0 || fstat(file, &status) < 0) {
+    perror(path);
+    return 1;
+  }
+  
+  verifier v;
+  v.size = status.st_size;
+  v.data = NULL;
+  if(v.size > 0) {
+    void *mapped = mmap(NULL, v.size, PROT_READ, MAP_PRIVATE, file, 0);
+    if(mapped == MAP_FAILED) {
+      perror(path);
+      return 1;
+    }
+    madvise(mapped, v.size, MADV_WILLNEED);
+    v.data = (const uint8_t *) mapped;
+  }
+  v.keys = &keys;
+  v.filter = &filter;
+  v.show = show;
+  v.simd_level = simd_level;
+  
+  auto start = std::chrono::steady_clock::now();
+  v.run(threads);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  size_t counts[VERDICTS] = {0}, total = 0;
+  std::vector<std::pair<size_t, verdict> > rejected;
+  for(const worker_result &result : v.results) {
+    for(unsigned int i = 0; i < VERDICTS; ++i) counts[i] += result.counts[i], total += result.counts[i];
+    rejected.insert(rejected.end(), result.rejected.begin(), result.rejected.end());
+  }
+  
+  std::sort(rejected.begin(), rejected.end());
+  for(const std::pair<size_t, verdict> &r : rejected) printf("%zu %s\n", r.first, verdict_names[r.second]);
+  
+  for(unsigned int i = 0; i < VERDICTS; ++i) printf("%-12s %12zu\n", verdict_names[i], counts[i]);
+  printf("%zu payloads in %.3f s with %u threads: %.0f payloads/s, %.1f MB/s\n", total, seconds, threads,
+         total/seconds, v.size/seconds/1e6);
+  
+  if(v.data) munmap((void *) v.data, v.size);
+  close(file);
+  return counts[VALID] == total ? 0 : 1;
+}
@@ -2,9 +2,17 @@
 
 #include <ESP8266WiFi.h>
 #include <PubSubClient.h>
-
-#include <BLAKE2s.h>
-#include <base64.hpp>
+#include <EEPROM.h>
+
+#include <signer.hpp>
+#include <constant_time.hpp>
+#include <replay_guard.hpp>
+#include <prefilter.hpp>
+#include <frame.hpp>
+#include <ack.hpp>
+#include <command.hpp>
+#include <registry.hpp>
+#include <time.h>
 
 // Definições de pinos
 #define BUTTON_PIN 5
@@ -12,18 +20,27 @@
 #define LED_PIN 12
 
 // definições de parâmetros de tempo
-#define T_DESTRAVADO 60000L
+#define T_DESTRAVADO 60000L // padrão, muda com o comando config
 #define T_ABERTO 1000
 
 // definições para as mensagens
 #define SEP '$'
+#define JANELA_REPLAY 60 // diferença máxima, em s, entre o timestamp da msg e a hora atual
+#define MAX_VERIFICACOES 5 // rajada máxima de verificações de assinatura
+#define T_VERIFICACAO 200  // ms para recuperar uma verificação (5 por segundo)
+#define T_RELATORIO 10000  // intervalo entre relatórios do filtro e dos comandos
+#define N_CHAVES 8         // IDs de chave aceitos, 0 a N_CHAVES - 1
+#define CHAVE_MESTRA 0     // única chave que pode adicionar e retirar chaves
+#define CHAVE_SALVA 0xA5   // marca de chave presente na EEPROM
 
 //---------------------------------------------//
 //            VARIÁVEIS GLOBAIS
 //---------------------------------------------//
 // variáveis do controle da porta
 unsigned long t_destravado, t_aberto;
+unsigned long t_liberacao = T_DESTRAVADO; // ms que a porta fica destravada
 bool destravado, aberto;
+bool reboot_pendente; // reinicia no loop(), depois do ack do comando reboot
 
 // variáveis do wifi
 const char* ssid = "****";
@@ -36,17 +53,39 @@ WiFiClient wclient;
 // const char* mqtt_server = "broker.mqttdashboard.com";
 IPAddress mqtt_server(192,168,1,75);
 const char* mqtt_inTopic = "testarhs/porta";   // nome do tópico de publicação
+const char* mqtt_inTopicBin = "testarhs/porta/bin"; // o mesmo, para quadros binários
 const char* mqtt_outTopic = "testarhs/server";  // nome do tópico de inscrição
 const unsigned long mqtt_rcinterval = 3000;     // Intervalo entre reconexões
 unsigned long mqtt_lastrc;
 PubSubClient mqtt_client(wclient);
 
+// variáveis da hora, sincronizada por NTP
+const char* ntp_server = "pool.ntp.org";
+const time_t hora_minima = 1600000000; // antes disso a hora ainda não foi sincronizada
+time_t hora_boot;  // hora do boot, calculada na primeira msg depois da sincronização
+
 // Variáveis para autenticação de msgs
-BLAKE2s blake;
+// chaves indexadas pelo ID que vem na msg, cada uma com o estado do BLAKE2s com
+// o bloco da chave já comprimido. A chave mestra gravada no firmware vale até
+// ser trocada por uma msg 'chave'
+keyring<N_CHAVES> chaves;
 byte sig_key[] = "you-will-never-guess-again";
 byte key_len = sizeof(sig_key) - 1;
-const byte sig_len = 16;
-const byte b64_len = (sig_len + 2) / 3 * 4;
+const byte sig_len = signature_tag_length;
+const byte b64_len = signature_lengths[SIGNATURE_BASE64];
+const byte b64url_len = signature_lengths[SIGNATURE_BASE64URL]; // base64 URL-safe sem padding
+
+// proteção contra repetição: lembra as msgs aceitas na janela de tempo, 772
+// bytes de RAM para até 64 msgs
+typedef replay_guard<64, 8> guarda_replay;
+guarda_replay replay(JANELA_REPLAY);
+#ifdef ACEITA_Z85
+const byte z85_len = signature_lengths[SIGNATURE_Z85]; // Z85, 20 caracteres
+#endif
+
+unsigned long t_relatorio;
+uint32_t rejeitadas_relatadas;
+uint32_t comandos_relatados;
 
 //---------------------------------------------//
 //            FUNÇÕES
@@ -74,23 +113,269 @@ void abre_porta() {
   mqtt_client.publish(mqtt_outTopic, "Porta aberta");
 }
 
-void sign(byte* hash, byte* msg, byte msg_len) {
-  blake.reset(sig_key, key_len, sig_len);
-  blake.update(msg, msg_len);
-  blake.finalize(hash, sig_len);
+// compara a tag recebida (já decodificada) com a calculada com a chave key_id,
+// em tempo constante. O hash parte de uma cópia do estado da chave, custa uma
+// compressão por msg qualquer que seja a chave. key_id deve estar ativa. É o
+// mesmo check_signature() usado pelo verificador de capturas (verify)
+bool check_payload(byte key_id, const byte* msg, byte msg_len, const byte* tag) {
+  return check_signature(chaves, key_id, msg, msg_len, tag);
+}
+
+// chaves adicionadas por msg ficam na EEPROM, uma marca e 32 bytes por ID
+struct chave_salva {
+  byte marca;
+  byte chave[32];
+};
+
+void salvar_chave(byte id, const byte* chave) {
+  chave_salva salva;
+  salva.marca = chave ? CHAVE_SALVA : 0;
+  if (chave) memcpy(salva.chave, chave, sizeof(salva.chave));
+  else memset(salva.chave, 0, sizeof(salva.chave));
+  EEPROM.put(id * sizeof(chave_salva), salva);
+  EEPROM.commit();
+}
+
+void carregar_chaves() {
+  EEPROM.begin(N_CHAVES * sizeof(chave_salva));
+  chaves.add(CHAVE_MESTRA, sig_key, key_len, sig_len);
+  for (byte id = 0; id < N_CHAVES; id++) {
+    chave_salva salva;
+    EEPROM.get(id * sizeof(chave_salva), salva);
+    if (salva.marca == CHAVE_SALVA) chaves.add(id, salva.chave, sizeof(salva.chave), sig_len);
+  }
+}
+
+// valor de um dígito hexadecimal minúsculo, ou -1
+int hex_digit(byte c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
 }
 
-bool check_payload(byte* msg, byte msg_len, byte* sig) {
-  byte test[sig_len];
-  sign(test, msg, msg_len);
-  byte b64[b64_len];
-  encode_base64(test, sig_len, b64);
-  for (int i = 0; i < b64_len; i++) {
-    if (b64[i] != sig[i]) return false;
+// administração das chaves, só com a chave mestra:
+//   chave:<ts>:+<id><64 dígitos hex> adiciona ou troca a chave <id>. A chave
+//     vem mascarada com mask_key() da chave mestra, com tudo o que a precede na
+//     msg como contexto, para o broker não conhecê-la
+//   chave:<ts>:-<id> retira a chave <id>, exceto a mestra
+bool comando_chave(const byte* payload, const command_view& partes) {
+  const byte* arg = payload + partes.argument_start;
+  int id = hex_digit(arg[1]);
+  if (partes.key_id != CHAVE_MESTRA || id < 0 || id >= N_CHAVES) {
+    Serial.println("comando de chave recusado");
+    return false;
+  }
+
+  if (arg[0] == '-' && partes.argument_length == 2 && id != CHAVE_MESTRA) {
+    chaves.retire(id);
+    salvar_chave(id, NULL);
+    Serial.print("chave retirada: ");
+    Serial.println(id);
+    return true;
+  }
+
+  if (arg[0] != '+' || partes.argument_length != 2 + 64) {
+    Serial.println("comando de chave recusado");
+    return false;
+  }
+
+  byte chave[32];
+  for (byte i = 0; i < 32; i++) {
+    int alto = hex_digit(arg[2 + 2*i]), baixo = hex_digit(arg[3 + 2*i]);
+    if (alto < 0 || baixo < 0) {
+      Serial.println("comando de chave recusado");
+      return false;
+    }
+    chave[i] = alto << 4 | baixo;
   }
+  chaves.mask_key(CHAVE_MESTRA, payload, partes.argument_start + 2, chave);
+  chaves.add(id, chave, sizeof(chave), sig_len);
+  salvar_chave(id, chave);
+  memset(chave, 0, sizeof(chave));
+  Serial.print("chave adicionada: ");
+  Serial.println(id);
+  return true;
+}
+
+// comandos sem argumento sobre a porta
+bool comando_liberar(const byte* payload, const command_view& partes) {
+  destravar_porta();
+  return true;
+}
+
+bool comando_travar(const byte* payload, const command_view& partes) {
+  travar_porta();
+  return true;
+}
+
+bool comando_abrir(const byte* payload, const command_view& partes) {
+  abre_porta();
+  t_aberto = millis();
+  return true;
+}
+
+// publica o estado da porta no tópico de saída
+bool comando_status(const byte* payload, const command_view& partes) {
+  mqtt_client.publish(mqtt_outTopic, destravado ? "Porta destravada" : "Porta travada");
+  if (aberto) mqtt_client.publish(mqtt_outTopic, "Porta aberta");
+  return true;
+}
+
+// config:<ts>:<s> muda por quantos segundos, de 1 a 3600, a porta fica
+// destravada depois de liberar. Não é gravado na EEPROM
+bool comando_config(const byte* payload, const command_view& partes) {
+  uint32_t segundos;
+  if (!parse_uint32(payload + partes.argument_start, partes.argument_length, segundos) ||
+      segundos < 1 || segundos > 3600) return false;
+  t_liberacao = segundos * 1000UL;
+  Serial.print("porta destravada por ");
+  Serial.print(segundos);
+  Serial.println(" s");
   return true;
 }
 
+// reinicia o dispositivo. A msg não pode ser repetida depois do boot, que
+// esvazia a proteção contra repetição, porque só se aceitam msgs com timestamp
+// posterior ao boot. ESP.restart() não volta, então só se marca o reboot aqui:
+// o callback publica o ack e o loop() reinicia depois de enviá-lo
+bool comando_reboot(const byte* payload, const command_view& partes) {
+  reboot_pendente = true;
+  return true;
+}
+
+// comandos aceitos, com o esquema do argumento. A tabela é constexpr: o
+// compilador acha o hash perfeito dos nomes, então achar o comando custa um
+// hash e uma comparação, quantos comandos houver. Nos quadros binários o
+// comando vem como opcode, a posição na tabela: novos comandos vão no fim
+constexpr command_spec especificacoes[] = {
+  {"liberar", {ARGUMENT_NONE, 0, 0}, comando_liberar},
+  {"travar", {ARGUMENT_NONE, 0, 0}, comando_travar},
+  {"abrir", {ARGUMENT_NONE, 0, 0}, comando_abrir},
+  {"status", {ARGUMENT_NONE, 0, 0}, comando_status},
+  {"config", {ARGUMENT_DIGITS, 1, 4}, comando_config},
+  {"reboot", {ARGUMENT_NONE, 0, 0}, comando_reboot},
+  {"chave", {ARGUMENT_TEXT, 2, 2 + 64}, comando_chave},
+};
+const size_t n_comandos = sizeof(especificacoes) / sizeof(especificacoes[0]);
+constexpr command_table<n_comandos> tabela(especificacoes);
+static_assert(tabela.perfect, "nomes de comando sem hash perfeito");
+
+// invocações e latência, em us, de cada comando
+typedef command_registry<n_comandos> registro_comandos;
+registro_comandos comandos(tabela);
+
+// filtro barato aplicado antes de calcular o hash: tópico, tamanhos, formato,
+// comando conhecido (pelo hash perfeito da tabela acima) e limite de
+// verificações por segundo.
+// Conta as msgs rejeitadas em cada etapa
+#ifdef ACEITA_Z85
+const byte sig_sizes[] = {b64_len, b64url_len, z85_len};
+#else
+const byte sig_sizes[] = {b64_len, b64url_len};
+#endif
+prefilter filtro(mqtt_inTopic, tabela, sig_sizes, sizeof(sig_sizes), SEP, token_bucket(MAX_VERIFICACOES, T_VERIFICACAO),
+                 mqtt_inTopicBin);
+
+// imprime as msgs rejeitadas pelo filtro por etapa, se houver novas. Não se
+// imprime nada a cada msg rejeitada para uma enxurrada não ocupar a serial
+void relatorio_filtro() {
+  uint32_t rejeitadas = 0;
+  for (byte i = 0; i < prefilter::STAGES; i++) rejeitadas += filtro.rejected[i];
+  if (rejeitadas == rejeitadas_relatadas) return;
+  rejeitadas_relatadas = rejeitadas;
+
+  Serial.print("filtro: topico ");
+  Serial.print(filtro.rejected[prefilter::TOPIC]);
+  Serial.print(", tamanho ");
+  Serial.print(filtro.rejected[prefilter::SIZE]);
+  Serial.print(", formato ");
+  Serial.print(filtro.rejected[prefilter::FORMAT]);
+  Serial.print(", comando ");
+  Serial.print(filtro.rejected[prefilter::COMMAND]);
+  Serial.print(", chave ");
+  Serial.print(filtro.rejected[prefilter::KEY]);
+  Serial.print(", taxa ");
+  Serial.print(filtro.rejected[prefilter::RATE]);
+  Serial.print(", verificadas ");
+  Serial.println(filtro.admitted);
+}
+
+// os resultados do registro são os primeiros resultados dos acks, na mesma ordem
+static_assert((int)registro_comandos::COMMAND_DONE == ACK_DONE &&
+              (int)registro_comandos::COMMAND_UNKNOWN == ACK_UNKNOWN_COMMAND, "resultados fora de ordem");
+
+// publica o ack de um comando autenticado no tópico de saída, com o resultado
+// e a hora (micros()) em que terminou. O backend casa o ack com o comando pelo
+// começo da tag e mede a latência com os três tempos
+void publicar_ack(command_ack& ack, byte resultado) {
+  ack.result = resultado;
+  ack.done = micros();
+  char texto[ack_max_length + 1];
+  format_ack(ack, texto);
+  mqtt_client.publish(mqtt_outTopic, texto);
+}
+
+// resultado de um comando como impresso
+const char* nome_resultado(registro_comandos::result resultado) {
+  switch (resultado) {
+    case registro_comandos::COMMAND_DONE: return "ok";
+    case registro_comandos::COMMAND_FAILED: return "falhou";
+    case registro_comandos::COMMAND_BAD_ARGUMENT: return "arg";
+    default: return "desconhecido";
+  }
+}
+
+// executa os comandos de um lote autenticado, na ordem, e publica o ack de
+// cada um, com a posição no lote (a partir de 1). O lote foi verificado uma vez
+// só: uma assinatura e um timestamp para todos os comandos. O payload está no
+// buffer do PubSubClient, que cada publish() sobrescreve, então os comandos
+// são lidos de uma cópia na pilha
+void executar_lote(const byte* payload, const prefilter::message& lote, command_ack& ack) {
+  byte copia[frame_batch_max_length];
+  memcpy(copia, payload, lote.length);
+
+  char resultados[6 + frame_max_batch * 13] = "lote:";
+  size_t fim = strlen(resultados);
+  size_t posicao = frame_batch_header_length;
+  prefilter::message partes;
+  while (next_batch_command(copia, lote, posicao, partes)) {
+    registro_comandos::result resultado = comandos.dispatch_opcode(copia, partes, micros);
+    ack.index++;
+    publicar_ack(ack, resultado);
+    const char* nome = nome_resultado(resultado);
+    resultados[fim++] = ' ';
+    memcpy(resultados + fim, nome, strlen(nome) + 1);
+    fim += strlen(nome);
+  }
+  Serial.println(resultados);
+}
+
+// imprime as invocações de cada comando, se houver novas: chamadas, argumento
+// recusado, falhas e latência média e máxima do handler
+void relatorio_comandos() {
+  uint32_t chamadas = 0;
+  for (byte i = 0; i < n_comandos; i++) chamadas += comandos.stats[i].calls;
+  if (chamadas == comandos_relatados) return;
+  comandos_relatados = chamadas;
+
+  for (byte i = 0; i < n_comandos; i++) {
+    const command_stats& s = comandos.stats[i];
+    if (s.calls == 0) continue;
+    uint32_t executados = s.calls - s.bad_arguments;
+    Serial.print(tabela.specs[i].name);
+    Serial.print(": chamadas ");
+    Serial.print(s.calls);
+    Serial.print(", arg. invalido ");
+    Serial.print(s.bad_arguments);
+    Serial.print(", falhas ");
+    Serial.print(s.failures);
+    Serial.print(", us medio ");
+    Serial.print(executados ? s.total_time / executados : 0);
+    Serial.print(", us max ");
+    Serial.println(s.max_time);
+  }
+}
+
 void reconnectWifi() {
   Serial.print("Conectado-se a rede ");
   Serial.print(ssid);
@@ -116,6 +401,7 @@ bool reconnectMQTT() {
     mqtt_client.publish(mqtt_outTopic, "hello world", true);
     // ... and resubscribe
     mqtt_client.subscribe(mqtt_inTopic);
+    mqtt_client.subscribe(mqtt_inTopicBin);
   } else {
     Serial.print("falha, rc=");
     Serial.print(mqtt_client.state());
@@ -128,30 +414,51 @@ bool reconnectMQTT() {
 
 // callback que lida com as mensagem recebidas
 void mqtt_callback(char* topic, byte* payload, unsigned int length) {
+  uint32_t t_recebido = micros();
+
+  // ignora, sem calcular o hash, msgs de outro tópico, com tamanho ou formato
+  // errado ou com comando desconhecido. Contadas em filtro.rejected. A msg não
+  // é copiada nem alocada: partes guarda onde está cada campo no payload, e o
+  // timestamp já convertido. No tópico binário vêm quadros de tamanho fixo
+  // (frame.hpp), aceitos junto com o texto durante a migração, e lotes de até
+  // frame_max_batch comandos sob uma só assinatura
+  prefilter::message partes;
+  bool quadro = strcmp(topic, mqtt_inTopicBin) == 0;
+  if (quadro ? !filtro.screen_frame(topic, payload, length, partes)
+             : !filtro.screen(topic, payload, length, partes)) return;
+  byte msg_len = partes.length;
+
+#ifdef MEDIR_CICLOS
+  uint32_t ciclos = ESP.getCycleCount();
+#endif
+
+  // decodifica a assinatura, lida direto do payload, uma única vez e rejeita
+  // as mal codificadas antes de calcular o hash. O formato vem do tamanho:
+  // base64 padrão, URL-safe sem padding ou, com ACEITA_Z85, Z85 (o filtro só
+  // deixa passar os tamanhos aceitos). Os quadros trazem a tag crua
+  byte decodificada[sig_len];
+  const byte* tag = quadro ? payload + msg_len : decodificada;
+  if (!quadro && !decode_message_signature(payload, partes, decodificada)) {
+    filtro.reject(prefilter::FORMAT);
+    return;
+  }
 
-  // encontrando o tamanho da mensagem, limitada por SEP
-  byte msg_len = 0;
-  for (; msg_len < length && payload[msg_len] != SEP; msg_len++);
-  // tamanho da assinatura
-  byte sig_size = length - msg_len - 1;
-
-  // ignora msg se a assinatura não tiver o tamanho correto
-  if (sig_size != b64_len) {
-    Serial.println("msg. mal formatada");
+  // a chave é escolhida pelo ID, direto no vetor
+  if (!chaves.contains(partes.key_id)) {
+    filtro.reject(prefilter::KEY);
     return;
   }
 
-  // guarda msg como string
-  char* msg = (char*)malloc(msg_len + 1);
-  memcpy(msg, (char*)payload, msg_len);
-  msg[msg_len + 1] = '\0';
+  // limita as verificações por segundo
+  if (!filtro.admit(millis())) return;
 
-  // guarda assinatura como lista de bytes
-  byte* sig = (byte*)malloc(sig_size);
-  memcpy(sig, payload + msg_len + 1, sig_size);
+  // testa assinatura direto no payload, sem copiar a msg
+  bool check = check_payload(partes.key_id, payload, msg_len, tag);
 
-  // testa assinatura
-  bool check = check_payload((byte*)msg, msg_len, sig);
+#ifdef MEDIR_CICLOS
+  Serial.print("ciclos na verificacao: ");
+  Serial.println(ESP.getCycleCount() - ciclos);
+#endif
 
   // ignora msg se a assinatura forneceda é incorreta
   if (!check) {
@@ -159,14 +466,67 @@ void mqtt_callback(char* topic, byte* payload, unsigned int length) {
     return;
   }
 
-  // agora que a msg foi autenticada execute o que foi pedido
+  // agora que a msg foi autenticada execute o que foi pedido. Toda msg
+  // autenticada recebe um ack (as forjadas não, para o filtro continuar
+  // barato); o começo da tag é copiado agora, antes que algum publish()
+  // sobrescreva o payload
   Serial.println("ass. autenticada");
+  command_ack ack;
+  memcpy(ack.correlation, tag, ack_correlation_length);
+  ack.index = 0;
+  ack.received = t_recebido;
+  ack.verified = micros();
+
+  // rejeita msgs repetidas ou com timestamp fora da janela. O timestamp já
+  // foi lido pelo filtro, que recusa os que não cabem em 32 bits
+  time_t agora = time(nullptr);
+  if (agora < hora_minima) {
+    Serial.println("hora nao sincronizada");
+    publicar_ack(ack, ACK_CLOCK_NOT_SET);
+    return;
+  }
+  if (hora_boot == 0) hora_boot = agora - millis() / 1000;
+  if ((time_t)partes.timestamp <= hora_boot) {
+    Serial.println("msg. anterior ao boot");
+    publicar_ack(ack, ACK_BEFORE_BOOT);
+    return;
+  }
+  switch (replay.check(agora, partes.timestamp, tag)) {
+    case guarda_replay::ACCEPTED:
+      break;
+    case guarda_replay::OUTSIDE_WINDOW:
+      Serial.println("msg. fora da janela de tempo");
+      publicar_ack(ack, ACK_OUTSIDE_WINDOW);
+      return;
+    case guarda_replay::REPLAYED:
+      Serial.println("msg. repetida");
+      publicar_ack(ack, ACK_REPLAYED);
+      return;
+    default:
+      Serial.println("cache de msgs cheio");
+      publicar_ack(ack, ACK_REPLAY_FULL);
+      return;
+  }
 
-  char* command = strtok(msg, ":");     // comando
-  long temp = atol(strtok(NULL, "\0")); // timestamp do envio da msg
+  if (quadro && is_batch_frame(payload)) {
+    executar_lote(payload, partes, ack);
+    return;
+  }
 
-  if(strcmp(command, "liberar") == 0 && temp > 0) {
-    destravar_porta();
+  // acha o comando pelo hash perfeito (ou pelo opcode, nos quadros), confere
+  // o argumento e chama o handler
+  registro_comandos::result resultado = quadro ? comandos.dispatch_opcode(payload, partes, micros)
+                                               : comandos.dispatch(payload, partes, micros);
+  publicar_ack(ack, resultado);
+  switch (resultado) {
+    case registro_comandos::COMMAND_BAD_ARGUMENT:
+      Serial.println("argumento invalido");
+      break;
+    case registro_comandos::COMMAND_FAILED:
+      Serial.println("comando falhou");
+      break;
+    default:
+      break;
   }
 }
 
@@ -189,6 +549,12 @@ void setup() {
   // configuracao do wifi
   WiFi.mode(WIFI_STA);
 
+  // sincroniza a hora (UTC) assim que houver conexão
+  configTime(0, 0, ntp_server);
+
+  // carrega as chaves, comprimindo o bloco de cada uma uma única vez
+  carregar_chaves();
+
   // configuração do MQTT
   mqtt_client.setServer(mqtt_server, 1883);
   mqtt_client.setCallback(mqtt_callback);
@@ -209,7 +575,7 @@ void loop() {
     }
 
     // retira a liberação da porta depois de 'T_LIBERADO' ms
-    if (millis() - t_destravado > T_DESTRAVADO) {
+    if (millis() - t_destravado > t_liberacao) {
       travar_porta();
     }
   }
@@ -240,4 +606,19 @@ void loop() {
 
   // executa loop do MQTT
   if (mqtt_client.connected()) mqtt_client.loop();
+
+  // reinicia depois de um comando reboot. O publish() do ack só escreve no
+  // WiFiClient; flush() espera os dados saírem antes do restart
+  if (reboot_pendente) {
+    wclient.flush();
+    Serial.println("reiniciando");
+    ESP.restart();
+  }
+
+  // relata as msgs rejeitadas pelo filtro e os comandos executados
+  if (millis() - t_relatorio > T_RELATORIO) {
+    relatorio_filtro();
+    relatorio_comandos();
+    t_relatorio = millis();
+  }
 }